@@ -3,14 +3,19 @@
  */
 #include "Crypto.hpp"
 #include "Helpers.hpp"
+#include "KEMPool.hpp"
+#include "Random.hpp"
+#include "Rounding.hpp"
+#include "SHA256.hpp"
 #include "../parameters.hpp"
 #include <openssl/evp.h>
+#include <immintrin.h>
 #include <NTL/ZZXFactoring.h>
 #include <NTL/ZZ_pE.h>
 #include <NTL/RR.h>
+#include <cstring>
 #include <iostream>
-#include <iomanip>
-#include <random>
+#include <stdexcept>
 #include <sstream>
 
 
@@ -18,106 +23,314 @@ using namespace std;
 using namespace NTL;
 
 
+/* number of 64-bit random words requested from the generator at once by the bulk samplers */
+static const size_t SAMPLE_BLOCK = 512;
+
+/**
+ * @brief Fills out[0..count) with uniform integers in [0,range), 0 < range < 2^64.
+ * Multiply-shift (Lemire) mapping, a draw is rejected only if the low product word falls below 2^64 mod range.
+ */
+static void sampleUniformWords(RandomGenerator &generator, uint64_t range, uint64_t *out, long count)
+{
+    const uint64_t threshold = (0 - range) % range;
+    uint64_t words[SAMPLE_BLOCK];
+    size_t available = 0, next = 0;
+
+    for (long i = 0; i < count; )
+    {
+        if (next == available)
+        {
+            available = min<size_t>(SAMPLE_BLOCK, count - i + 1);
+            generator.fill((uint8_t *) words, available * sizeof(uint64_t));
+            next = 0;
+        }
+        uint128_t product = (uint128_t) words[next++] * range;
+        if ((uint64_t) product >= threshold)
+            out[i++] = (uint64_t) (product >> 64);
+    }
+}
+
+/**
+ * @brief Fills the coefficients with uniform integers in [0,range), 0 < range < 2^128, split into low and high words.
+ * Same mapping as sampleUniformWords on 128-bit draws.
+ */
+static void sampleUniformWords128(RandomGenerator &generator, uint128_t range, uint64_t *low, uint64_t *high, long count)
+{
+    const uint128_t threshold = (0 - range) % range;
+    uint64_t words[SAMPLE_BLOCK];
+    size_t available = 0, next = 0;
+
+    for (long i = 0; i < count; )
+    {
+        if (next == available)
+        {
+            available = min<size_t>(SAMPLE_BLOCK, 2 * (count - i + 1));
+            generator.fill((uint8_t *) words, available * sizeof(uint64_t));
+            next = 0;
+        }
+        uint128_t draw = ((uint128_t) words[next + 1] << 64) | words[next], product_hi, product_lo;
+        next += 2;
+        mul128Wide(draw, range, product_hi, product_lo);
+        if (product_lo >= threshold)
+        {
+            low[i] = (uint64_t) product_hi;
+            high[i] = (uint64_t) (product_hi >> 64);
+            i++;
+        }
+    }
+}
+
 /**
- * @brief Sampling small uniform polynomial of degree N in the range [lbound,ubound],
+ * @brief Maps 16-bit words r < 65535 to (r mod 3) - 1 and stores it as a ring coefficient (-1 is stored as q-1).
+ * r mod 3 is computed as r - 3*floor(r*43691/2^17), exact for r < 2^17.
+ */
+static void ternaryFromWords(const uint16_t *words, uint64_t *low, uint64_t *high, uint128_t q_minus_one)
+{
+    for (long i = 0; i < N; i++)
+    {
+        int value = (int) words[i] - 3 * (int) (((uint32_t) words[i] * 43691) >> 17) - 1;
+        low[i] = value < 0 ? (uint64_t) q_minus_one : (uint64_t) value;
+        high[i] = value < 0 ? (uint64_t) (q_minus_one >> 64) : 0;
+    }
+}
+
+/**
+ * @brief AVX2 version of ternaryFromWords, 16 coefficients per iteration.
+ */
+__attribute__((target("avx2")))
+static void ternaryFromWordsAVX2(const uint16_t *words, uint64_t *low, uint64_t *high, uint128_t q_minus_one)
+{
+    const __m256i magic = _mm256_set1_epi16((short) 43691),
+                  three = _mm256_set1_epi16(3),
+                  one = _mm256_set1_epi16(1),
+                  zero = _mm256_setzero_si256(),
+                  q_low = _mm256_set1_epi64x((long long) (uint64_t) q_minus_one),
+                  q_high = _mm256_set1_epi64x((long long) (uint64_t) (q_minus_one >> 64));
+
+    for (long i = 0; i < N; i += 16)
+    {
+        __m256i r = _mm256_loadu_si256((const __m256i *) (words + i));
+        __m256i quotient = _mm256_srli_epi16(_mm256_mulhi_epu16(r, magic), 1);
+        __m256i value = _mm256_sub_epi16(_mm256_sub_epi16(r, _mm256_mullo_epi16(quotient, three)), one);
+        __m128i halves[2] = {_mm256_castsi256_si128(value), _mm256_extracti128_si256(value, 1)};
+
+        for (int h = 0; h < 2; h++)
+        {
+            __m128i quarters[2] = {halves[h], _mm_srli_si128(halves[h], 8)};
+            for (int k = 0; k < 2; k++)
+            {
+                __m256i value64 = _mm256_cvtepi16_epi64(quarters[k]);
+                __m256i negative = _mm256_cmpgt_epi64(zero, value64);
+                long offset = i + 8 * h + 4 * k;
+                _mm256_storeu_si256((__m256i *) (low + offset), _mm256_blendv_epi8(value64, q_low, negative));
+                _mm256_storeu_si256((__m256i *) (high + offset), _mm256_and_si256(negative, q_high));
+            }
+        }
+    }
+}
+
+/**
+ * @brief Samples all N ternary coefficients at once from 16-bit words of the keystream.
+ * The word 0xFFFF is rejected (65535 = 3*21845), so the remaining words are uniform modulo 3.
+ */
+static void sampleTernaryPolynomial(RandomGenerator &generator, RingElement &ternary_polynomial)
+{
+    uint16_t words[N];
+    generator.fill((uint8_t *) words, sizeof(words));
+    for (long i = 0; i < N; i++)
+        while (words[i] == 0xFFFF)
+            generator.fill((uint8_t *) &words[i], sizeof(uint16_t));
+
+    if (__builtin_cpu_supports("avx2"))
+        ternaryFromWordsAVX2(words, ternary_polynomial.low(), ternary_polynomial.high(), ringModulus().q - 1);
+    else
+        ternaryFromWords(words, ternary_polynomial.low(), ternary_polynomial.high(), ringModulus().q - 1);
+}
+
+/**
+ * @brief Sampling small uniform polynomial of degree N-1 in the range [lbound,ubound],
  * negative values represented with modulo q.
  * @param lbound lower bound
  * @param ubound upper bound
  */
-ZZ_pE sampleSmallUniformPolynomial(const long long lbound, const long long ubound)
+RingElement sampleSmallUniformPolynomial(const long long lbound, const long long ubound)
 {
-    /* samples uniform polynomial */
-    /* random number generation, uniform from [lbound,ubound], using 32 bit Mersenne Twister */
-    random_device rd;
-    mt19937 generator(rd());
-    uniform_int_distribution<long long> distr(lbound,ubound);
-
-    ZZ_pX uniform_polynomial;
-    ZZ coefficient;
-    for(int i=0; i <= N; i++)
+    RingElement uniform_polynomial;
+    sampleSmallUniformPolynomial(lbound, ubound, uniform_polynomial);
+    return uniform_polynomial;
+}
+
+/**
+ * @brief Samples into an existing ring element, the ternary range [-1,1] takes the vectorized path.
+ * @param lbound lower bound
+ * @param ubound upper bound
+ * @param uniform_polynomial output, every coefficient is overwritten
+ */
+void sampleSmallUniformPolynomial(const long long lbound, const long long ubound, RingElement& uniform_polynomial)
+{
+    /* random number generation, uniform from [lbound,ubound], using the thread's buffered CSPRNG */
+    RandomGenerator &generator = RandomGenerator::threadLocal();
+    if (lbound == -1 && ubound == 1)
     {
-        coefficient = distr(generator);
-        SetCoeff(uniform_polynomial,i,conv<ZZ_p>(coefficient));
+        sampleTernaryPolynomial(generator, uniform_polynomial);
+        return;
     }
-    uniform_polynomial.normalize();
 
-    return conv<ZZ_pE>(uniform_polynomial);
+    const Modulus128 &modulus = ringModulus();
+    uint64_t *offsets = uniform_polynomial.low();     // offsets from lbound, converted in place
+    sampleUniformWords(generator, (uint64_t) (ubound - lbound) + 1, offsets, N);
+    for(int i=0; i < N; i++)
+    {
+        uniform_polynomial.setCoefficient(i, modulus.fromSigned(lbound + (long long) offsets[i]));
+    }
 }
 
 /**
- * @brief Samples uniform polynomial of degree N in the range [-bound,bound], negative values represented with modulo q.
+ * @brief Samples uniform polynomial of degree N-1 in the range [-bound,bound], negative values represented with modulo q.
  * @param bound integer that determines the range to sample from
  */
-ZZ_pE sampleBigUniformPolynomial(const ZZ& bound)
+RingElement sampleBigUniformPolynomial(const ZZ& bound)
 {
-    ZZ_pX uniform_polynomial;
+    RingElement uniform_polynomial;
+    sampleBigUniformPolynomial(bound, uniform_polynomial);
+    return uniform_polynomial;
+}
+
+/**
+ * @brief Samples into an existing ring element, used to reuse one noise buffer over many samples.
+ * @param bound integer that determines the range to sample from
+ * @param uniform_polynomial output, every coefficient is overwritten
+ */
+void sampleBigUniformPolynomial(const ZZ& bound, RingElement& uniform_polynomial)
+{
+    if (NumBits(bound) > 125 || bound >= q)
+        throw invalid_argument("sampleBigUniformPolynomial: bound must be smaller than q");
+
+    RandomGenerator &generator = RandomGenerator::threadLocal();
+    const Modulus128 &modulus = ringModulus();
+    const uint128_t bound_word = ZZToWord128(bound), range = 2*bound_word+1;
+    uint64_t *low = uniform_polynomial.low(), *high = uniform_polynomial.high();
 
-    for(int i=0; i <= N; i++)
+    /* r in [0,2*bound] stands for r-bound, negative values are shifted by q */
+    if ((range >> 64) == 0)
     {
-        SetCoeff(uniform_polynomial,i,conv<ZZ_p>(RandomBnd(2*bound+1)-bound));
+        sampleUniformWords(generator, (uint64_t) range, low, N);
+        for(int i=0; i < N; i++)
+        {
+            uint128_t r = low[i];
+            uniform_polynomial.setCoefficient(i, r >= bound_word ? r-bound_word : modulus.q-(bound_word-r));
+        }
+    }
+    else
+    {
+        sampleUniformWords128(generator, range, low, high, N);
+        for(int i=0; i < N; i++)
+        {
+            uint128_t r = uniform_polynomial.coefficient(i);
+            uniform_polynomial.setCoefficient(i, r >= bound_word ? r-bound_word : modulus.q-(bound_word-r));
+        }
     }
-    uniform_polynomial.normalize();
-
-    return conv<ZZ_pE>(uniform_polynomial);
 }
 
 /**
  * @brief Slightly optimized sampling (for a value).
  * @param bound integer that determines the range to sample from
- * Samples uniform polynomial of degree N in the range [0,bound-1], negative values represented with modulo q.
+ * Samples uniform polynomial of degree N-1 in the range [0,bound-1], negative values represented with modulo q.
  */
-ZZ_pE aSampleBigUniformPolynomial(const ZZ& bound)
+RingElement aSampleBigUniformPolynomial(const ZZ& bound)
 {
-    ZZ_pX uniform_polynomial;
+    RingElement uniform_polynomial;
+    aSampleBigUniformPolynomial(bound, uniform_polynomial);
+    return uniform_polynomial;
+}
 
-    for(int i=0; i <= N; i++)
-    {
-        SetCoeff(uniform_polynomial,i,conv<ZZ_p>(RandomBnd(bound)));
-    }
-    uniform_polynomial.normalize();
+/**
+ * @brief Samples into an existing ring element, the coefficients are drawn directly into its storage.
+ * @param bound integer that determines the range to sample from
+ * @param uniform_polynomial output, every coefficient is overwritten
+ */
+void aSampleBigUniformPolynomial(const ZZ& bound, RingElement& uniform_polynomial)
+{
+    if (NumBits(bound) > 127)
+        throw invalid_argument("aSampleBigUniformPolynomial: bound must be smaller than 2^127");
+
+    const Modulus128 &modulus = ringModulus();
+    const uint128_t bound_word = ZZToWord128(bound);
+    sampleUniformWords128(RandomGenerator::threadLocal(), bound_word, uniform_polynomial.low(), uniform_polynomial.high(), N);
 
-    return conv<ZZ_pE>(uniform_polynomial);
+    if (bound_word > modulus.q)
+        for(int i=0; i < N; i++)
+        {
+            uniform_polynomial.setCoefficient(i, modulus.reduce(uniform_polynomial.coefficient(i)));
+        }
 }
 
 /**
- * @brief SHA256 - implementation from the openssl library.
- * @param plaintext string that is to be hashed
+ * @brief Samples a ring element from the SHAKE128 stream of an input by rejection.
+ * @param input bytes the stream is derived from
+ * @param length number of input bytes
+ * @param element output, every coefficient is overwritten
+ * The keystream is SHAKE128(input || counter) for counter = 0,1,..., cut into 16-byte little-endian words w,
+ * coefficient = floor(w*q/2^128), w being rejected if (w*q mod 2^128) < 2^128 mod q (probability below 2^-50).
  */
-string hashSHA256(const string& plaintext)
+static void xofToRing(const uint8_t *input, size_t length, RingElement &element)
 {
-    /* creates message digest context (memory allocation) */
+    const Modulus128 &modulus = ringModulus();
+    vector<uint8_t> stream(16 * N);
     EVP_MD_CTX *context = EVP_MD_CTX_new();
+    long i = 0;
 
-    if(context != nullptr)
+    for (uint8_t counter = 0; i < N; counter++)
     {
-        /* initializes digest context */
-        if(EVP_DigestInit_ex(context, EVP_sha256(), nullptr))
+        if (context == nullptr
+            || !EVP_DigestInit_ex(context, EVP_shake128(), nullptr)
+            || !EVP_DigestUpdate(context, input, length)
+            || !EVP_DigestUpdate(context, &counter, 1)
+            || !EVP_DigestFinalXOF(context, stream.data(), stream.size()))
         {
-            /* hashes plaintext.length() bytes of data at plaintext.c_str() into the digest context*/
-            if(EVP_DigestUpdate(context, plaintext.c_str(), plaintext.length()))
-            {
-                unsigned char hash[EVP_MAX_MD_SIZE];
-                unsigned int lengthOfHash = 0;
-
-                /* retrieves digest result from 'context' and puts into output buffer 'hash' */
-                if(EVP_DigestFinal_ex(context, hash, &lengthOfHash))
-                {
-                    std::stringstream ss;
-                    for(unsigned int i = 0; i < lengthOfHash; ++i)
-                    {
-                        /* formats hash elements into human-readable hexadecimal form */
-                        ss << std::hex << std::setw(2) << std::setfill('0') << (int)hash[i];
-                    }
-                    EVP_MD_CTX_free(context);
-
-                    return ss.str();
-                }
-            }
+            EVP_MD_CTX_free(context);
+            throw runtime_error("xofToRing: SHAKE128 failed");
+        }
+
+        for (size_t offset = 0; offset < stream.size() && i < N; offset += 16)
+        {
+            uint128_t word = 0, product_hi, product_lo;
+            for (int b = 15; b >= 0; b--)
+                word = (word << 8) | stream[offset + b];
+            mul128Wide(word, modulus.q, product_hi, product_lo);
+            if (product_lo >= modulus.r_mod)
+                element.setCoefficient(i++, product_hi);
         }
-        /* cleans context and frees memory allocated */
-        EVP_MD_CTX_free(context);
     }
-    return "";
+
+    EVP_MD_CTX_free(context);
+}
+
+/**
+ * @brief Expands the public value a from a 32-byte seed, so only the seed has to be published and stored.
+ * @param seed A_SEED_SIZE bytes published by the evaluator
+ * @param a output, every coefficient is overwritten
+ */
+void expandPublicPolynomial(const uint8_t *seed, RingElement &a)
+{
+    xofToRing(seed, A_SEED_SIZE, a);
+}
+
+RingElement expandPublicPolynomial(const uint8_t *seed)
+{
+    RingElement a;
+    expandPublicPolynomial(seed, a);
+    return a;
+}
+
+/**
+ * @brief SHA256 as a hex string, kept for the legacy string-based formats and for display.
+ * @param plaintext string that is to be hashed
+ * Binary digests without the hex round-trip come from SHA256Context.
+ */
+string hashSHA256(const string& plaintext)
+{
+    return toHex(SHA256Context::threadLocal().reset().update(plaintext).finish());
 }
 
 /**
@@ -162,35 +375,165 @@ vector<string> hashCoefficients(const ZZX& secret_polynomial)
     return output_coefficients;
 }
 
+/**
+ * @brief Table of hexchar(v) * 256^j mod q, the contribution of hex digit v at byte j of a legacy coefficient.
+ * hashDigestToIntegerModQ() reads the 64 ASCII hex characters of a digest as a little-endian integer.
+ */
+struct HexDigitPowers
+{
+    uint128_t contribution[2 * SHA256_DIGEST_SIZE][16];
+
+    HexDigitPowers()
+    {
+        const Modulus128 &modulus = ringModulus();
+        static const char hex_digits[] = "0123456789abcdef";
+        uint128_t power = 1;
+        for (size_t j = 0; j < 2 * SHA256_DIGEST_SIZE; j++)
+        {
+            for (int v = 0; v < 16; v++)
+                contribution[j][v] = modulus.mul(modulus.reduce((uint8_t) hex_digits[v]), power);
+            power = modulus.mul(power, 256);
+        }
+    }
+};
+
+/**
+ * @brief Legacy-compatible a_x, the same ring element as hashing with hashCoefficients() and spawnRingPolynomial().
+ * @param secret_polynomial polynomial with integer coefficients
+ * @param a_x output, every coefficient is overwritten
+ * The N+1 messages "ih" are hashed by sha256Many() into binary digests, the value of each hex string mod q is
+ * summed from the HexDigitPowers table, and coefficient N is folded onto coefficient 0 (x^N = -1).
+ */
+void hashCoefficientsToRing(const ZZX &secret_polynomial, RingElement &a_x)
+{
+    static const HexDigitPowers powers;
+    const Modulus128 &modulus = ringModulus();
+    const size_t MESSAGE_STRIDE = 24 + 2 * SHA256_DIGEST_SIZE;
+
+    stringstream ss;
+    for (int i=0; i<=deg(secret_polynomial); i++)
+    {
+        ss << coeff(secret_polynomial,i);
+    }
+    string h = hashSHA256(ss.str());
+
+    vector<uint8_t> messages((N + 1) * MESSAGE_STRIDE), digests((N + 1) * SHA256_DIGEST_SIZE);
+    vector<const uint8_t *> message_pointers(N + 1);
+    vector<size_t> lengths(N + 1);
+    for (long i = 0; i <= N; i++)
+    {
+        uint8_t *message = messages.data() + i * MESSAGE_STRIDE;
+        string index = to_string(i);
+        memcpy(message, index.data(), index.size());
+        memcpy(message + index.size(), h.data(), h.size());
+        message_pointers[i] = message;
+        lengths[i] = index.size() + h.size();
+    }
+    sha256Many(message_pointers.data(), lengths.data(), N + 1, digests.data());
+
+    uint128_t folded = 0;
+    for (long i = N; i >= 0; i--)
+    {
+        const uint8_t *digest = digests.data() + i * SHA256_DIGEST_SIZE;
+        uint128_t value = 0;
+        for (size_t k = 0; k < SHA256_DIGEST_SIZE; k++)
+        {
+            value = modulus.add(value, powers.contribution[2 * k][digest[k] >> 4]);
+            value = modulus.add(value, powers.contribution[2 * k + 1][digest[k] & 15]);
+        }
+        if (i == N)
+            folded = value;
+        else
+            a_x.setCoefficient(i, i == 0 ? modulus.sub(value, folded) : value);
+    }
+}
+
+/**
+ * @brief Hashes a client's secret polynomial directly onto the ring with one SHAKE128 stream.
+ * @param secret_polynomial polynomial with non-negative integer coefficients
+ * @param a_x output, every coefficient is overwritten
+ * The input is the domain tag followed by, for every coefficient, its byte length (4 bytes) and its little-endian bytes.
+ */
+void hashToRing(const ZZX &secret_polynomial, RingElement &a_x)
+{
+    static const char domain_tag[] = "PQ-BRAKE hash-to-ring a_x";
+    vector<uint8_t> input(domain_tag, domain_tag + sizeof(domain_tag));
+
+    for (long i = 0; i <= deg(secret_polynomial); i++)
+    {
+        const ZZ &coefficient = coeff(secret_polynomial, i);
+        if (sign(coefficient) < 0)
+            throw invalid_argument("hashToRing: coefficients must be non-negative");
+        uint32_t length = (uint32_t) NumBytes(coefficient);
+        for (int b = 0; b < 4; b++)
+            input.push_back((uint8_t) (length >> (8 * b)));
+        input.resize(input.size() + length);
+        BytesFromZZ(input.data() + input.size() - length, coefficient, length);
+    }
+
+    xofToRing(input.data(), input.size(), a_x);
+}
+
 /**
  * @brief Rounding procedure, values are shifted into <-q/2,q/2> range and rounded (ties rounded down).
  * @param polynom polynomial in the ring
+ * Computed exactly with integer thresholds by roundingPacked(), this converts its bit planes to NTL form.
  */
-ZZX rounding(const ZZ_pE& polynom)
+ZZX rounding(const RingElement& polynom)
 {
-    ZZ_pX pre_rounded_polynom;
-    ZZX rounded_polynom;
-    pre_rounded_polynom = conv<ZZ_pX>(polynom);
+    return roundingPacked(polynom).toZZX();
+}
 
-    RR  element,
-        q_half = floor(conv<RR>(q)/conv<RR>(2)),
-        q_floating = conv<RR>(q),
-        q_p_rounding_multiplier = conv<RR>(q)/conv<RR>(p);
+/**
+ * @brief Derives the KEM key generation seed from a rounded OPRF output, streamed into SHA256 without strings.
+ * @param rounded rounded polynomial
+ * @param kem_seed output, KEM_SEED_SIZE bytes
+ * @param mode KEMSeedMode::Packed hashes the parity plane (the output mod p = 2, N/8 bytes, little-endian words),
+ * KEMSeedMode::Legacy reproduces the first 32 hex characters of hashSHA256(printZZXconcatenated(rounded)).
+ * The sign plane is never hashed, enrollment and verification only agree on the output mod 2.
+ */
+void hashRoundedPolynomial(const RoundedPolynomial &rounded, uint8_t *kem_seed, KEMSeedMode mode)
+{
+    SHA256Context &context = SHA256Context::threadLocal().reset();
 
-    /* rounding procedure - multiplying by 1/(q/p) and rounding to the nearest int with ties rounded down */
-    for (int i=0; i<=deg(pre_rounded_polynom); i++)
+    if (mode == KEMSeedMode::Packed)
     {
-        element = conv<RR>(conv<ZZ>(coeff(pre_rounded_polynom,i)));
-        if (element > q_half)
-            element -= q_floating;
-        /* using ceiling(element-0.5) as workaround to get rounding-down on ties, default NTL functions round-to-even */
-        element = ceil((element/q_p_rounding_multiplier)-0.5);
-        SetCoeff(rounded_polynom, i, conv<ZZ>(element));
+        uint8_t parity[RoundedPolynomial::WORDS * sizeof(uint64_t)];
+        for (long w = 0; w < RoundedPolynomial::WORDS; w++)
+            for (int b = 0; b < 8; b++)
+                parity[8 * w + b] = (uint8_t) (rounded.parity[w] >> (8 * b));
+        context.update(parity, (N + 7) / 8).finish(kem_seed);
+        return;
     }
 
-    rounded_polynom.normalize();
+    /* legacy: decimal coefficients "-1", "0", "1" up to the degree of the normalized polynomial */
+    long degree = RoundedPolynomial::WORDS - 1;
+    while (degree >= 0 && rounded.parity[degree] == 0)
+        degree--;
+    degree = degree < 0 ? -1 : 64 * degree + 63 - __builtin_clzll(rounded.parity[degree]);
+
+    uint8_t buffer[256];
+    size_t used = 0;
+    for (long i = 0; i <= degree; i++)
+    {
+        int value = rounded.coefficient(i);
+        if (value < 0)
+            buffer[used++] = '-';
+        buffer[used++] = value != 0 ? '1' : '0';
+        if (used > sizeof(buffer) - 2)
+        {
+            context.update(buffer, used);
+            used = 0;
+        }
+    }
+    SHA256Digest digest = context.update(buffer, used).finish();
 
-    return rounded_polynom;
+    static const char hex_digits[] = "0123456789abcdef";
+    for (size_t k = 0; k < KEM_SEED_SIZE / 2; k++)
+    {
+        kem_seed[2 * k] = (uint8_t) hex_digits[digest[k] >> 4];
+        kem_seed[2 * k + 1] = (uint8_t) hex_digits[digest[k] & 15];
+    }
 }
 
 /**
@@ -232,7 +575,7 @@ ZZX OPRFWithTimings(Client *client,
 
     /* Sampling */
     auto sampling_big_a_start = chrono::steady_clock::now();
-    ZZ_pE a = aSampleBigUniformPolynomial(q);
+    evaluator->generate_a_seed();
     auto sampling_big_a_end = chrono::steady_clock::now();
     sampling_big_a.push_back(std::chrono::duration<double, std::milli>(sampling_big_a_end - sampling_big_a_start).count());
 
@@ -248,7 +591,8 @@ ZZX OPRFWithTimings(Client *client,
 
     /* EVALUATOR computes c, value is sent to client and stored there */
     auto compute_c_start = chrono::steady_clock::now();
-    evaluator->c = evaluator->compute_c(a);
+    evaluator->c = evaluator->compute_c(evaluator->a);
+    evaluator->commit();
     auto compute_c_end = chrono::steady_clock::now();
     compute_c.push_back(std::chrono::duration<double, std::milli>(compute_c_end - compute_c_start).count());
 
@@ -271,7 +615,7 @@ ZZX OPRFWithTimings(Client *client,
 
     /* CLIENT computes c_x and "sends" value to EVALUATOR who uses it*/
     auto compute_c_x_start = chrono::steady_clock::now();
-    evaluator->c_x = client->compute_c_x(a);
+    evaluator->c_x = client->compute_c_x(evaluator->a_ntt);
     auto compute_c_x_end = chrono::steady_clock::now();
     compute_c_x.push_back(std::chrono::duration<double, std::milli>(compute_c_x_end - compute_c_x_start).count());
 
@@ -289,13 +633,14 @@ ZZX OPRFWithTimings(Client *client,
 
     /* CLIENT computes y */
     auto compute_y_start = chrono::steady_clock::now();
-    client->y = client->d_x-(evaluator->c*client->s);
+    client->y = client->compute_y(evaluator->c_ntt);
     auto compute_y_end = chrono::steady_clock::now();
     compute_y.push_back(std::chrono::duration<double, std::milli>(compute_y_end - compute_y_start).count());
 
     /* CLIENT rounds y */
     auto rounding_y_start = chrono::steady_clock::now();
-    client->y_rounded = client->y_rounded = rounding(client->y);
+    roundingPacked(client->y, client->y_packed);
+    client->y_rounded = client->y_packed.toZZX();
     auto rounding_y_end = chrono::steady_clock::now();
     rounding_y.push_back(std::chrono::duration<double, std::milli>(rounding_y_end - rounding_y_start).count());
 
@@ -309,13 +654,18 @@ ZZX OPRFWithTimings(Client *client,
  * @param client client object
  * @param evaluator evaluator object
  * @param common_values_initialized true if the server already published its commitment (values a,k,e,c)
+ * @param kem_seed if not null, receives the KEM key generation seed derived from the output
+ * Returns the client's packed output; y and y_rounded are not built on this path.
+ * @param blinding if not null, s, e' and a*s + e' are taken from this queue, which must be built for the evaluator's a
+ * With common_values_initialized the evaluator is only read, so sessions with distinct clients may run concurrently.
  */
-ZZX OPRF(Client *client, Evaluator *evaluator, bool common_values_initialized)
+const RoundedPolynomial &OPRF(Client *client, Evaluator *evaluator, bool common_values_initialized, uint8_t *kem_seed,
+                              BlindingQueue *blinding)
 {
     if (!common_values_initialized)
     {
-        /* Sampling */
-        evaluator->a = aSampleBigUniformPolynomial(q);
+        /* Sampling, a is expanded from a published seed */
+        evaluator->generate_a_seed();
 
         /* Sampling key (k) and RLWE error (e) as ternary polynomials */
         evaluator->k = sampleSmallUniformPolynomial(-1, 1);
@@ -323,32 +673,32 @@ ZZX OPRF(Client *client, Evaluator *evaluator, bool common_values_initialized)
 
         /* EVALUATOR computes c, value is sent to client and stored there */
         evaluator->c = evaluator->compute_c(evaluator->a);
-    }
-
-    /* CLIENT computes */
-    client->s = sampleSmallUniformPolynomial(-1, 1);
 
-    client->e_prime = sampleSmallUniformPolynomial(-1, 1);
+        /* EVALUATOR caches the transforms of a, k and c, reused by every following session */
+        evaluator->commit();
+    }
 
     /* CLIENT computes a_x (hashed fuzzy vault candidate polynomial) */
     client->a_x = client->compute_a_x();
 
-    /* CLIENT computes c_x and "sends" value to EVALUATOR who uses it*/
-    evaluator->c_x = client->compute_c_x(evaluator->a);
-
-    /* EVALUATOR samples a large noise value (E) from [-B,B] */
-    evaluator->E = sampleBigUniformPolynomial(B);
-
-    /* EVALUATOR computes d_x, value is sent to client */
-    client->d_x = evaluator->compute_d_x();
+    /* CLIENT computes c_x and "sends" value to EVALUATOR who uses it, s and e' are precomputed if possible */
+    RingElement c_x;
+    if (blinding != nullptr)
+        c_x = client->compute_c_x(blinding->pop());
+    else
+    {
+        client->s = sampleSmallUniformPolynomial(-1, 1);
+        client->e_prime = sampleSmallUniformPolynomial(-1, 1);
+        c_x = client->compute_c_x(evaluator->a_ntt);
+    }
 
-    /* CLIENT computes y */
-    client->y = client->d_x-(evaluator->c*client->s);
+    /* EVALUATOR computes d_x with its own large noise (E) from [-B,B], value is sent to client */
+    client->d_x = evaluator->evaluate(c_x);
 
-    /* CLIENT rounds y */
-    client->y_rounded = client->y_rounded = rounding(client->y);
+    /* CLIENT unblinds and rounds y in one pass, optionally hashing it into the KEM seed (client->kem_seed_mode) */
+    client->finalize(evaluator->c_ntt, kem_seed);
 
-    return client->y_rounded;
+    return client->y_packed;
 }
 
 /**
@@ -366,14 +716,13 @@ oqs::bytes kyberWithTimings(std::vector<double> &timings_KeyGen,
                             std::vector<double> &timings_Decap,
                             const string &kyber_version)
 {
-    oqs::KeyEncapsulation KEM_client{kyber_version};
-    oqs::KeyEncapsulation KEM_server{kyber_version};
-    oqs::bytes ciphertext, client_shared_secret, server_shared_secret;
+    KEMPool::Lease KEM_client = KEMPool::borrow(kyber_version);
+    KEMPool::Lease KEM_server = KEMPool::borrow(kyber_version);
 
     auto KeyGen_timer_start = chrono::steady_clock::now();
 
-    /* generates keypair, secret key is not returned but is generated and stored in the KEM_client object */
-    oqs::bytes client_public_key = KEM_client.generate_keypair();
+    /* generates keypair, the secret key is not returned but is kept in the KEM_client handle */
+    const oqs::bytes &client_public_key = KEM_client->generateKeypair();
 
     auto KeyGen_timer_end = chrono::steady_clock::now();
     timings_KeyGen.push_back(std::chrono::duration<double, std::milli>(KeyGen_timer_end - KeyGen_timer_start).count());
@@ -381,7 +730,7 @@ oqs::bytes kyberWithTimings(std::vector<double> &timings_KeyGen,
     auto Encap_timer_start = chrono::steady_clock::now();
 
     /* a shared secret is randomly generated and encapsulated with the client's public key */
-    std::tie(ciphertext, server_shared_secret) = KEM_server.encap_secret(client_public_key);
+    const oqs::bytes &server_shared_secret = KEM_server->encapsulate(client_public_key);
 
     auto Encap_timer_end = chrono::steady_clock::now();
 
@@ -390,7 +739,7 @@ oqs::bytes kyberWithTimings(std::vector<double> &timings_KeyGen,
     auto Decap_timer_start = chrono::steady_clock::now();
 
     /* client attempts to recover (decapsulate) the shared secret from the ciphertext using its secret key */
-    client_shared_secret = KEM_client.decap_secret(ciphertext);
+    const oqs::bytes &client_shared_secret = KEM_client->decapsulate(KEM_server->ciphertext());
 
     auto Decap_timer_end = chrono::steady_clock::now();
 
@@ -407,4 +756,93 @@ oqs::bytes kyberWithTimings(std::vector<double> &timings_KeyGen,
         oqs::bytes empty_shared_secret = convert_to_oqs_bytes("", 1);
         return {empty_shared_secret};
     }
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Checks a runtime KEM choice against the KEMs enabled in the linked liboqs.
+ * @param kem_algorithm liboqs name of the KEM, e.g. "Kyber768"
+ * Returns the name unchanged, throws invalid_argument listing the enabled KEMs otherwise.
+ */
+const std::string &requireEnabledKEM(const std::string &kem_algorithm)
+{
+    if (!oqs::KEMs::is_KEM_enabled(kem_algorithm))
+    {
+        ostringstream message;
+        message << "KEM not enabled: " << kem_algorithm << ", enabled KEMs:";
+        for (const string &name : oqs::KEMs::get_enabled_KEMs())
+            message << " " << name;
+        throw invalid_argument(message.str());
+    }
+    return kem_algorithm;
+}
+
+/**
+ * @brief Checks that a KEM can derive its keypair from the OPRF output, as PQ-BRAKE enrollment and verification do.
+ * @param kem_algorithm liboqs name of the KEM
+ * Seeded key generation (OQS_KEM_keypair_based_on_input, KEM_SEED_SIZE bytes) only exists for the Kyber variants
+ * of the modified liboqs. Returns the name unchanged, throws invalid_argument otherwise.
+ */
+const std::string &requireSeededKEM(const std::string &kem_algorithm)
+{
+    requireEnabledKEM(kem_algorithm);
+    if (kem_algorithm != "Kyber512" && kem_algorithm != "Kyber768" && kem_algorithm != "Kyber1024")
+        throw invalid_argument("KEM without seeded key generation: " + kem_algorithm
+                               + ", PQ-BRAKE needs one of Kyber512, Kyber768, Kyber1024");
+    return kem_algorithm;
+}
+
+/**
+ * @brief Measures keygen, encapsulation and decapsulation of one KEM through kyberWithTimings.
+ * @param kem_algorithm liboqs name of the KEM
+ * @param iterations number of complete KEM runs, the first one is a warmup run and not counted
+ */
+KEMPerformance measureKEMPerformance(const std::string &kem_algorithm, int iterations)
+{
+    const auto details = oqs::KeyEncapsulation(requireEnabledKEM(kem_algorithm)).get_details();
+    KEMPerformance performance;
+    performance.name = kem_algorithm;
+    performance.claimed_nist_level = details.claimed_nist_level;
+    performance.public_key_size = details.length_public_key;
+    performance.secret_key_size = details.length_secret_key;
+    performance.ciphertext_size = details.length_ciphertext;
+    performance.shared_secret_size = details.length_shared_secret;
+    performance.is_ind_cca = details.is_ind_cca;
+    performance.iterations = iterations;
+
+    vector<double> timings_KeyGen, timings_Encap, timings_Decap;
+    oqs::bytes empty_shared_secret = convert_to_oqs_bytes("", 1);
+    for (int i = 0; i <= iterations; i++)
+    {
+        vector<double> keygen, encap, decap;
+        oqs::bytes KEM_output = kyberWithTimings(keygen, encap, decap, kem_algorithm);
+        if (i == 0)
+            continue;       // warmup run
+        if (KEM_output == empty_shared_secret)
+        {
+            performance.failures++;
+            continue;
+        }
+        timings_KeyGen.push_back(keygen.front());
+        timings_Encap.push_back(encap.front());
+        timings_Decap.push_back(decap.front());
+    }
+
+    performance.keygen_ms = computeAverage(timings_KeyGen);
+    performance.encap_ms = computeAverage(timings_Encap);
+    performance.decap_ms = computeAverage(timings_Decap);
+    double round_trip_ms = performance.keygen_ms + performance.encap_ms + performance.decap_ms;
+    performance.operations_per_second = round_trip_ms > 0 ? 1000 / round_trip_ms : 0;
+    return performance;
+}
+
+/**
+ * @brief Performance of every KEM enabled in the linked liboqs, in liboqs order.
+ * @param iterations number of counted runs per KEM
+ */
+std::vector<KEMPerformance> measureKEMPerformanceMatrix(int iterations)
+{
+    vector<KEMPerformance> matrix;
+    for (const string &name : oqs::KEMs::get_enabled_KEMs())
+        matrix.push_back(measureKEMPerformance(name, iterations));
+    return matrix;
+}
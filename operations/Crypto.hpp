@@ -10,6 +10,29 @@
 #include "../oqs_cpp.h"
 #include <vector>
 
+const std::size_t A_SEED_SIZE = 32;     /**< size of the seed the public value a is expanded from */
+const std::size_t KEM_SEED_SIZE = 32;   /**< size of the KEM key generation seed derived from the OPRF output */
+
+/**
+ * @brief Sizes and measured costs of one KEM algorithm, one row of the KEM performance matrix.
+ */
+struct KEMPerformance
+{
+    std::string name;
+    std::size_t claimed_nist_level = 0,
+                public_key_size = 0,
+                secret_key_size = 0,
+                ciphertext_size = 0,
+                shared_secret_size = 0;
+    bool        is_ind_cca = false;
+    double      keygen_ms = 0,              /**< averages over the successful runs, the warmup run excluded */
+                encap_ms = 0,
+                decap_ms = 0,
+                operations_per_second = 0;  /**< complete keygen + encap + decap round trips per second */
+    int         iterations = 0,
+                failures = 0;
+};
+
 
 std::string hashSHA256(const std::string &plaintext);
 
@@ -17,13 +40,29 @@ NTL::ZZ hashDigestToIntegerModQ(const std::string &digest_string);
 
 std::vector<std::string> hashCoefficients(const NTL::ZZX &secret_polynomial);
 
-NTL::ZZX rounding(const NTL::ZZ_pE &polynom);
+void hashCoefficientsToRing(const NTL::ZZX &secret_polynomial, RingElement &a_x);
+
+void hashToRing(const NTL::ZZX &secret_polynomial, RingElement &a_x);
+
+NTL::ZZX rounding(const RingElement &polynom);
+
+void hashRoundedPolynomial(const RoundedPolynomial &rounded, uint8_t *kem_seed, KEMSeedMode mode);
+
+RingElement sampleSmallUniformPolynomial(long long lbound, long long ubound);
 
-NTL::ZZ_pE sampleSmallUniformPolynomial(long long lbound, long long ubound);
+void sampleSmallUniformPolynomial(long long lbound, long long ubound, RingElement &uniform_polynomial);
 
-NTL::ZZ_pE sampleBigUniformPolynomial(const NTL::ZZ &bound);
+RingElement sampleBigUniformPolynomial(const NTL::ZZ &bound);
 
-NTL::ZZ_pE aSampleBigUniformPolynomial(const NTL::ZZ &bound);
+void sampleBigUniformPolynomial(const NTL::ZZ &bound, RingElement &uniform_polynomial);
+
+RingElement aSampleBigUniformPolynomial(const NTL::ZZ &bound);
+
+void aSampleBigUniformPolynomial(const NTL::ZZ &bound, RingElement &uniform_polynomial);
+
+void expandPublicPolynomial(const uint8_t *seed, RingElement &a);
+
+RingElement expandPublicPolynomial(const uint8_t *seed);
 
 NTL::ZZX OPRFWithTimings(Client *client, Evaluator *evaluator, std::vector<double> &sampling_big_a,
                          std::vector<double> &sampling_small_k, std::vector<double> &sampling_small_e,
@@ -33,7 +72,16 @@ NTL::ZZX OPRFWithTimings(Client *client, Evaluator *evaluator, std::vector<doubl
                          std::vector<double> &compute_d_x, std::vector<double> &compute_y,
                          std::vector<double> &rounding_y);
 
-NTL::ZZX OPRF(Client *client, Evaluator *evaluator, bool common_values_initialized);
+const RoundedPolynomial &OPRF(Client *client, Evaluator *evaluator, bool common_values_initialized,
+                              uint8_t *kem_seed = nullptr, BlindingQueue *blinding = nullptr);
 
 oqs::bytes kyberWithTimings(std::vector<double> &timings_KeyGen, std::vector<double> &timings_Encap,
                             std::vector<double> &timings_Decap, const string &kyber_version);
+
+const std::string &requireEnabledKEM(const std::string &kem_algorithm);
+
+const std::string &requireSeededKEM(const std::string &kem_algorithm);
+
+KEMPerformance measureKEMPerformance(const std::string &kem_algorithm, int iterations);
+
+std::vector<KEMPerformance> measureKEMPerformanceMatrix(int iterations);
@@ -0,0 +1,161 @@
+/**
+ *  Pre-generated ephemeral KEM keypairs
+ */
+#include "EphemeralKeyPool.hpp"
+#include "KEMPool.hpp"
+#include <chrono>
+#include <stdexcept>
+
+
+void EphemeralKeypair::zeroize()
+{
+    oqs::C::OQS_MEM_cleanse(secret_key.data(), secret_key.size());
+}
+
+/**
+ * @brief Starts the producer, which fills the pool right away.
+ * @param capacity maximum number of pre-generated keypairs
+ * @param kem_version liboqs name of the KEM
+ */
+EphemeralKeyPool::EphemeralKeyPool(std::size_t capacity, const std::string &kem_version)
+    : capacity(capacity), kem_version(kem_version), slots(new Slot[capacity])
+{
+    if (capacity == 0)
+        throw std::invalid_argument("EphemeralKeyPool needs a capacity of at least one");
+    for (std::size_t i = 0; i < capacity; i++)
+        slots[i].sequence.store(i, std::memory_order_relaxed);
+    producer = std::thread(&EphemeralKeyPool::produce, this);
+}
+
+/**
+ * @brief Stops the producer and zeroizes the keypairs that were never taken.
+ */
+EphemeralKeyPool::~EphemeralKeyPool()
+{
+    stopping.store(true, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lock(idle_mutex);
+    }
+    slot_freed.notify_all();
+    producer.join();
+
+    EphemeralKeypair keypair;
+    while (tryPop(keypair))
+        keypair.zeroize();
+}
+
+/**
+ * @brief Moves the keypair into the next free slot, fails without blocking if the ring is full.
+ */
+bool EphemeralKeyPool::tryPush(EphemeralKeypair &keypair)
+{
+    std::size_t position = enqueue_position.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        Slot &slot = slots[position % capacity];
+        std::ptrdiff_t difference = (std::ptrdiff_t) slot.sequence.load(std::memory_order_acquire) - (std::ptrdiff_t) position;
+        if (difference == 0)
+        {
+            if (enqueue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+            {
+                slot.keypair = std::move(keypair);
+                slot.sequence.store(position + 1, std::memory_order_release);
+                return true;
+            }
+        }
+        else if (difference < 0)
+            return false;
+        else
+            position = enqueue_position.load(std::memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief Moves the oldest keypair out of its slot, fails without blocking if the ring is empty.
+ * The slot keeps no copy of the secret key, vectors are moved.
+ */
+bool EphemeralKeyPool::tryPop(EphemeralKeypair &keypair)
+{
+    std::size_t position = dequeue_position.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        Slot &slot = slots[position % capacity];
+        std::ptrdiff_t difference = (std::ptrdiff_t) slot.sequence.load(std::memory_order_acquire) - (std::ptrdiff_t) (position + 1);
+        if (difference == 0)
+        {
+            if (dequeue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+            {
+                keypair = std::move(slot.keypair);
+                slot.keypair = EphemeralKeypair();
+                slot.sequence.store(position + capacity, std::memory_order_release);
+                return true;
+            }
+        }
+        else if (difference < 0)
+            return false;
+        else
+            position = dequeue_position.load(std::memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief Generates one keypair with a pooled KEM handle of the calling thread.
+ */
+EphemeralKeypair EphemeralKeyPool::generate() const
+{
+    KEMPool::Lease kem = KEMPool::borrow(kem_version);
+    EphemeralKeypair keypair;
+    keypair.public_key = kem->generateKeypair();
+    keypair.secret_key = kem->secretKey();
+    return keypair;
+}
+
+/**
+ * @brief Producer loop, generates keypairs while the ring has free slots and sleeps while it is full.
+ */
+void EphemeralKeyPool::produce()
+{
+    EphemeralKeypair keypair;
+    bool pending = false;
+    while (!stopping.load(std::memory_order_acquire))
+    {
+        if (!pending)
+        {
+            keypair = generate();
+            pending = true;
+        }
+        if (tryPush(keypair))
+        {
+            pending = false;
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(idle_mutex);
+        if (!stopping.load(std::memory_order_acquire))
+            slot_freed.wait_for(lock, std::chrono::milliseconds(10));     // bounded, a wakeup sent while not waiting is not lost for long
+    }
+    if (pending)
+        keypair.zeroize();
+}
+
+/**
+ * @brief Hands out one keypair, a pre-generated one (hit) or one generated on the spot (miss).
+ */
+EphemeralKeypair EphemeralKeyPool::take()
+{
+    EphemeralKeypair keypair;
+    if (tryPop(keypair))
+    {
+        hit_count.fetch_add(1, std::memory_order_relaxed);
+        slot_freed.notify_one();
+        return keypair;
+    }
+    miss_count.fetch_add(1, std::memory_order_relaxed);
+    return generate();
+}
+
+std::size_t EphemeralKeyPool::size() const
+{
+    std::size_t enqueued = enqueue_position.load(std::memory_order_acquire),
+                dequeued = dequeue_position.load(std::memory_order_acquire);
+    return enqueued > dequeued ? enqueued - dequeued : 0;
+}
@@ -0,0 +1,72 @@
+/**
+ *  Pre-generated ephemeral KEM keypairs
+ */
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "../oqs_cpp.h"
+
+/**
+ * @brief Ephemeral keypair, independent of the session it is used in.
+ */
+struct EphemeralKeypair
+{
+    oqs::bytes  public_key,
+                secret_key;
+
+    void zeroize();
+};
+
+/**
+ * @brief Bounded lock-free pool of ephemeral keypairs, refilled by a background producer thread.
+ * take() removes a keypair from the ring without locking; if the pool is empty the keypair is generated on the
+ * spot and counted as a miss. Each keypair is handed out once, the ones never taken are zeroized by the
+ * destructor. The producer only blocks while the ring is full.
+ */
+class EphemeralKeyPool
+{
+public:
+    explicit EphemeralKeyPool(std::size_t capacity, const std::string &kem_version = "Kyber768");
+    ~EphemeralKeyPool();
+
+    EphemeralKeyPool(const EphemeralKeyPool &) = delete;
+    EphemeralKeyPool &operator=(const EphemeralKeyPool &) = delete;
+
+    EphemeralKeypair take();
+    std::size_t size() const;
+    std::size_t hits() const { return hit_count.load(std::memory_order_relaxed); }
+    std::size_t misses() const { return miss_count.load(std::memory_order_relaxed); }
+
+private:
+    /* bounded MPMC ring, each slot's sequence tells whether it is free for position pos (== pos) or holds
+     * the keypair of position pos (== pos + 1) */
+    struct Slot
+    {
+        std::atomic<std::size_t> sequence;
+        EphemeralKeypair keypair;
+    };
+
+    bool tryPush(EphemeralKeypair &keypair);
+    bool tryPop(EphemeralKeypair &keypair);
+    EphemeralKeypair generate() const;
+    void produce();
+
+    const std::size_t capacity;
+    const std::string kem_version;
+    std::unique_ptr<Slot[]> slots;
+
+    alignas(64) std::atomic<std::size_t> enqueue_position{0};
+    alignas(64) std::atomic<std::size_t> dequeue_position{0};
+    std::atomic<std::size_t> hit_count{0},
+                             miss_count{0};
+
+    std::atomic<bool> stopping{false};
+    std::mutex idle_mutex;                  /**< only used by the producer to sleep while the ring is full */
+    std::condition_variable slot_freed;
+    std::thread producer;
+};
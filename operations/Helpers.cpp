@@ -25,32 +25,28 @@ oqs::bytes convert_to_oqs_bytes(const char *c_str, std::size_t length) {
 }
 
 /**
- * @brief Constructs a ZZ_pE type polynomial (element of ring) from an array of integer coefficients.
+ * @brief Constructs a ring element from an array of N+1 integer coefficients, reducing them mod q.
  * @param coefficients pointer to first element of an array of integer polynomial coefficients
- * This is needed due to certain intricacies in NTL's manipulation of polynomial coefficients.
+ * The coefficient of x^N wraps around onto the constant term with a negative sign, since x^N = -1 in the ring.
  */
-ZZ_pE spawnRingPolynomial(ZZ *coefficients) {
-    ZZ_pX ring_polynomial;
+RingElement spawnRingPolynomial(ZZ *coefficients) {
+    const Modulus128 &modulus = ringModulus();
+    RingElement ring_polynomial;
 
-    for (int i = 0; i <= N; i++) {
-        ZZ_p coefficient = conv < ZZ_p > (coefficients[i]);
-        SetCoeff(ring_polynomial, i, coefficient);
+    for (int i = 0; i < N; i++) {
+        ring_polynomial.setCoefficient(i, ZZToWord128(coefficients[i] % q));
     }
-    ring_polynomial.normalize();
+    ring_polynomial.setCoefficient(0, modulus.sub(ring_polynomial.coefficient(0), ZZToWord128(coefficients[N] % q)));
 
-    return conv < ZZ_pE > (ring_polynomial);
+    return ring_polynomial;
 }
 
 /**
- * @brief Sets up a ring as defined by the NTL library, initializing the modulo q, and a cyclotomic polynomial of deg N.
+ * @brief Installs the shared ring context (ZZ_p modulo q, ZZ_pE modulo x^N+1) on the calling thread.
+ * Worker threads that need NTL ring types install it themselves, see RingContextGuard.
  */
 void ringSetup() {
-    /* Ring setup */
-    ZZ_p::init(q);               // setting the current modulo q for integers mod q NTL class
-    ZZ_pX P(INIT_MONO, N);
-    SetCoeff(P, 0, 1);             // Cyclotomic polynomial x^N+1
-
-    ZZ_pE::init(P);              // ring extension over ZZ_p (integer modulo q)
+    RingContext::shared().install();
 }
 
 /**
@@ -75,13 +71,12 @@ vector<RR> qShifting(vector<RR> coefficients) {
  * @brief Converts an element of the ring to a vector of floating point values.
  * @param polynom polynomial in the ring
  */
-vector<RR> pEtoVectorRR(const ZZ_pE &polynom) {
+vector<RR> pEtoVectorRR(const RingElement &polynom) {
     vector<RR> coefficients_in_RR;
 
-    for (int i = 0; i <= deg(conv < ZZ_pX > (polynom)); i++) {
-        /* conversion goes from ZZ_p to ZZ to RR, nothing lost since original value is already an 0<=integer<q */
-        coefficients_in_RR.push_back(conv < RR > (conv < ZZ > (coeff(conv < ZZ_pX > (polynom),
-                                                                     i))));
+    for (int i = 0; i < N; i++) {
+        /* conversion goes from a machine word to ZZ to RR, nothing lost since original value is already an 0<=integer<q */
+        coefficients_in_RR.push_back(conv < RR > (word128ToZZ(polynom.coefficient(i))));
     }
 
     return coefficients_in_RR;
@@ -152,70 +147,68 @@ void printParameters() {
  * @param iter vector of double type values
  */
 void OPRFCheckLogging(Client *client, Evaluator *evaluator, ofstream &OutputFile, int iter) {
-    ZZ_pE lift;
-    ZZX a_x_k_rounded;
-    lift = client->a_x * evaluator->k;
-    a_x_k_rounded = rounding(lift);
-
-    ZZ_pPush push;                  /**< backup of current modulus */
-    ZZ_p::init(conv < ZZ > (2));        // sets current modulus to 2
-
-    /* converts results to binary representation */
-    ZZ_pX a_x_k_rounded_mod_2 = conv < ZZ_pX > (a_x_k_rounded), y_rounded_mod2 = conv < ZZ_pX > (client->y_rounded);
-
-    if (a_x_k_rounded_mod_2 != y_rounded_mod2) {
-        OutputFile << "\n--------------------------------------------------------------\n"
-                   << ">>>>>>>>>>>>>>>>>>>> ITERATION: " << setw(9) << iter
-                   << " <<<<<<<<<<<<<<<<<<<<\n--------------------------------------------------------------\n";
-        OutputFile << "OPRF - FAILED" << "\n";
-        OutputFile << "-------------------- ERRORS AT: --------------------\n";
-
-        for (int i = 0; i <= deg(y_rounded_mod2); i++)               // checks at which coefficient the error occurs
-        {
-            if (coeff(a_x_k_rounded_mod_2, i) != coeff(y_rounded_mod2, i)) {
-                OutputFile << i << ". coeff. (y,a_x*k) => " << coeff(y_rounded_mod2, i) << ", "
-                           << coeff(a_x_k_rounded_mod_2, i) << "\n";
-
-                OutputFile << "y = " << coeff(conv < ZZ_pX > (client->y), i) << "\n" << "a_x*k = "
-                           << coeff(conv < ZZ_pX > (lift), i) << "\n";
-
-                OutputFile << "q/2-shifted y     = " << qShifting(pEtoVectorRR(client->y))[i] << " -> "
-                           << conv < RR >
-                           (conv < ZZ > (qShifting(pEtoVectorRR(client->y))[i])) / (conv < RR > (q) / conv < RR > (p))
-                           << "\n"
-                           << "q/2-shifted a_x*k = "
-                           << qShifting(pEtoVectorRR(lift))[i]
-                           << " -> "
-                           << conv <
-                RR > (conv < ZZ > (qShifting(pEtoVectorRR(lift))[i])) / (conv < RR > (q) / conv < RR > (p))
-                << "\n" << "----------" << "\n";
-            }
+    /* fast packed comparison first, the detailed NTL diagnostics are only built for a failed iteration */
+    long mismatches = OPRFMismatches(client, evaluator);
+    if (mismatches == 0) {
+        return;
+    }
+
+    RingElement lift = ringMultiply(client->a_x, evaluator->k_ntt);
+    RoundedPolynomial a_x_k_rounded = roundingPacked(lift);
+
+    /* results are compared mod 2 on the parity planes, no modulus switching */
+    OutputFile << "\n--------------------------------------------------------------\n"
+               << ">>>>>>>>>>>>>>>>>>>> ITERATION: " << setw(9) << iter
+               << " <<<<<<<<<<<<<<<<<<<<\n--------------------------------------------------------------\n";
+    OutputFile << "OPRF - FAILED, mismatching coefficients: " << mismatches << "\n";
+    OutputFile << "-------------------- ERRORS AT: --------------------\n";
+
+    for (int i = 0; i < N; i++)               // checks at which coefficient the error occurs
+    {
+        int y_bit = client->y_packed.coefficient(i) & 1, a_x_k_bit = a_x_k_rounded.coefficient(i) & 1;
+        if (y_bit != a_x_k_bit) {
+            OutputFile << i << ". coeff. (y,a_x*k) => " << y_bit << ", " << a_x_k_bit << "\n";
+
+            OutputFile << "y = " << word128ToZZ(client->y.coefficient(i)) << "\n" << "a_x*k = "
+                       << word128ToZZ(lift.coefficient(i)) << "\n";
+
+            OutputFile << "q/2-shifted y     = " << qShifting(pEtoVectorRR(client->y))[i] << " -> "
+                       << conv < RR >
+                       (conv < ZZ > (qShifting(pEtoVectorRR(client->y))[i])) / (conv < RR > (q) / conv < RR > (p))
+                       << "\n"
+                       << "q/2-shifted a_x*k = "
+                       << qShifting(pEtoVectorRR(lift))[i]
+                       << " -> "
+                       << conv <
+            RR > (conv < ZZ > (qShifting(pEtoVectorRR(lift))[i])) / (conv < RR > (q) / conv < RR > (p))
+            << "\n" << "----------" << "\n";
         }
-        /* exception that indicates to the test that this is a failed iteration */
-        throw 1;
     }
+    /* exception that indicates to the test that this is a failed iteration */
+    throw (int) mismatches;
+}
+
+/**
+ * @brief Counts the coefficients on which the client's output differs from a_x*k rounded, mod 2.
+ * @param client client object, y_packed must hold the OPRF output
+ * @param evaluator evaluator object, k_ntt is reused for the product
+ */
+long OPRFMismatches(Client *client, Evaluator *evaluator) {
+    RoundedPolynomial a_x_k_rounded;
+    roundingPacked(ringMultiply(client->a_x, evaluator->k_ntt), a_x_k_rounded);
+    return parityMismatches(a_x_k_rounded, client->y_packed);
 }
 
 /**
  * @brief Checks if the OPRF unblinding procedure failed.
  * @param client client object
  * @param evaluator evaluator object
- * @param OutputFile output file to save logs into
- * @param iter vector of double type values
+ * Throws the number of mismatching coefficients (int) on failure.
  */
 void OPRFCheck(Client *client, Evaluator *evaluator) {
-    ZZ_pE lift;
-    ZZX a_x_k_rounded;
-    lift = client->a_x * evaluator->k;
-    a_x_k_rounded = rounding(lift);
-
-    ZZ_pPush push;                  // backs up current modulus
-    ZZ_p::init(conv < ZZ > (2));        // set modulus to 2
-    ZZ_pX a_x_k_rounded_mod_2 = conv < ZZ_pX > (a_x_k_rounded), y_rounded_mod2 =
-            conv < ZZ_pX > (client->y_rounded);    // converts results to binary representation
-
-    if (a_x_k_rounded_mod_2 != y_rounded_mod2) {
-        throw 1;
+    long mismatches = OPRFMismatches(client, evaluator);
+    if (mismatches != 0) {
+        throw (int) mismatches;
     }
 }
 
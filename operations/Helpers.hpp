@@ -16,13 +16,13 @@
 #include "../participants/Server.hpp"
 #include "../oqs_cpp.h"
 
-NTL::ZZ_pE spawnRingPolynomial(NTL::ZZ *coefficients);
+RingElement spawnRingPolynomial(NTL::ZZ *coefficients);
 
 void ringSetup();
 
 std::vector<NTL::RR> qShifting(std::vector<NTL::RR> coefficients);
 
-std::vector<NTL::RR> pEtoVectorRR(const NTL::ZZ_pE &polynom);
+std::vector<NTL::RR> pEtoVectorRR(const RingElement &polynom);
 
 NTL::RR computeExpectedErrorRate();
 
@@ -36,6 +36,8 @@ oqs::bytes convert_to_oqs_bytes(const char *c_str, std::size_t length);
 
 void OPRFCheckLogging(Client *client, Evaluator *evaluator, ofstream &OutputFile, int iter);
 
+long OPRFMismatches(Client *client, Evaluator *evaluator);
+
 void OPRFCheck(Client *client, Evaluator *evaluator);
 
 std::string printZZXconcatenated(const NTL::ZZX &polynomial);
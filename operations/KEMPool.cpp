@@ -0,0 +1,117 @@
+/**
+ *  Reusable KEM handles with preallocated buffers
+ */
+#include "KEMPool.hpp"
+#include <iterator>
+#include <stdexcept>
+
+
+/**
+ * @brief Creates the KEM object and allocates all buffers for it.
+ * @param kem_version liboqs name of the KEM
+ */
+KEMHandle::KEMHandle(const std::string &kem_version)
+    : kem_version(kem_version), kem(kem_version)
+{
+    const auto &details = kem.get_details();
+    pk.resize(details.length_public_key);
+    ct.resize(details.length_ciphertext);
+    ss.resize(details.length_shared_secret);
+}
+
+KEMHandle::~KEMHandle()
+{
+    clear();
+}
+
+/**
+ * @brief Generates a fresh keypair, the secret key stays in the handle.
+ */
+const oqs::bytes &KEMHandle::generateKeypair()
+{
+    kem.generate_keypair(pk);
+    return pk;
+}
+
+/**
+ * @brief Derives the keypair deterministically from a seed, the secret key stays in the handle.
+ * @param seed KEM_SEED_SIZE bytes, e.g. the client's hashed OPRF output
+ */
+const oqs::bytes &KEMHandle::generateKeypair(const uint8_t *seed)
+{
+    kem.generate_keypair_based_on_input(const_cast<uint8_t *>(seed), pk);
+    return pk;
+}
+
+/**
+ * @brief Uses a stored secret key for the following decapsulations.
+ */
+void KEMHandle::loadSecretKey(const oqs::bytes &secret_key)
+{
+    kem.import_secret_key(secret_key);
+}
+
+/**
+ * @brief Encapsulates a fresh shared secret, the ciphertext is left in ciphertext().
+ * @param public_key public key of the receiver
+ */
+const oqs::bytes &KEMHandle::encapsulate(const oqs::bytes &public_key)
+{
+    kem.encap_secret(public_key, ct, ss);
+    return ss;
+}
+
+/**
+ * @brief Recovers the shared secret with the handle's secret key.
+ * @param ciphertext ciphertext of the sender
+ */
+const oqs::bytes &KEMHandle::decapsulate(const oqs::bytes &ciphertext)
+{
+    kem.decap_secret(ciphertext, ss);
+    return ss;
+}
+
+/**
+ * @brief Cleanses the secret key and the shared secret, the buffers keep their size.
+ */
+void KEMHandle::clear()
+{
+    kem.cleanse_secret_key();
+    oqs::C::OQS_MEM_cleanse(ss.data(), ss.size());
+}
+
+KEMPool &KEMPool::threadLocal()
+{
+    thread_local KEMPool pool;
+    return pool;
+}
+
+/**
+ * @brief Takes an idle handle of the calling thread's pool, a new one is created only if none is idle.
+ * @param kem_version liboqs name of the KEM
+ */
+KEMPool::Lease KEMPool::borrow(const std::string &kem_version)
+{
+    KEMPool &pool = threadLocal();
+    for (auto it = pool.handles.rbegin(); it != pool.handles.rend(); ++it)
+    {
+        if ((*it)->version() == kem_version)
+        {
+            std::unique_ptr<KEMHandle> handle = std::move(*it);
+            pool.handles.erase(std::next(it).base());
+            return Lease(pool, std::move(handle));
+        }
+    }
+    return Lease(pool, std::unique_ptr<KEMHandle>(new KEMHandle(kem_version)));
+}
+
+/**
+ * @brief Cleanses the handle's secrets and puts it back into the pool it was borrowed from.
+ */
+KEMPool::Lease::~Lease()
+{
+    if (!handle)
+        return;
+    handle->clear();
+    pool.handles.push_back(std::move(handle));
+}
@@ -0,0 +1,84 @@
+/**
+ *  Reusable KEM handles with preallocated buffers
+ */
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include "../oqs_cpp.h"
+
+/**
+ * @brief One ready KEM object with key, ciphertext and shared secret buffers allocated once.
+ * The results stay in the handle's buffers until the next operation, the secret key stays inside the KEM object
+ * and is never copied by the handle; secret values are cleansed by clear(), which runs whenever the handle goes
+ * back to its pool.
+ */
+class KEMHandle
+{
+public:
+    explicit KEMHandle(const std::string &kem_version);
+    ~KEMHandle();
+
+    KEMHandle(const KEMHandle &) = delete;
+    KEMHandle &operator=(const KEMHandle &) = delete;
+
+    const oqs::bytes &generateKeypair();
+    const oqs::bytes &generateKeypair(const uint8_t *seed);
+    void loadSecretKey(const oqs::bytes &secret_key);
+    const oqs::bytes &encapsulate(const oqs::bytes &public_key);
+    const oqs::bytes &decapsulate(const oqs::bytes &ciphertext);
+    void clear();
+
+    const oqs::bytes &publicKey() const { return pk; }
+    const oqs::bytes &secretKey() const { return kem.view_secret_key(); }
+    const oqs::bytes &ciphertext() const { return ct; }
+    const oqs::bytes &sharedSecret() const { return ss; }
+    const std::string &version() const { return kem_version; }
+
+private:
+    const std::string kem_version;
+    oqs::KeyEncapsulation kem;
+    oqs::bytes  pk,
+                ct,
+                ss;
+};
+
+/**
+ * @brief Per-thread pool of KEM handles, borrow() hands out a handle that returns to the pool with its lease.
+ * Handles are created on first use and then reused, so an operation costs only the KEM arithmetic instead of
+ * OQS_KEM_new and fresh buffers. A lease must end on the thread that borrowed it; the pool needs no lock.
+ */
+class KEMPool
+{
+public:
+    class Lease
+    {
+    public:
+        Lease(Lease &&other) noexcept : pool(other.pool), handle(std::move(other.handle)) {}
+        ~Lease();
+
+        Lease(const Lease &) = delete;
+        Lease &operator=(const Lease &) = delete;
+        Lease &operator=(Lease &&) = delete;
+
+        KEMHandle &operator*() const { return *handle; }
+        KEMHandle *operator->() const { return handle.get(); }
+
+    private:
+        friend class KEMPool;
+        Lease(KEMPool &pool, std::unique_ptr<KEMHandle> handle) : pool(pool), handle(std::move(handle)) {}
+
+        KEMPool &pool;
+        std::unique_ptr<KEMHandle> handle;
+    };
+
+    static Lease borrow(const std::string &kem_version = "Kyber768");
+    static KEMPool &threadLocal();
+
+    std::size_t size() const { return handles.size(); }
+
+private:
+    KEMPool() = default;
+
+    std::vector<std::unique_ptr<KEMHandle>> handles;     /**< idle handles, any version */
+};
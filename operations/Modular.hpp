@@ -0,0 +1,194 @@
+/**
+ *  Fixed-width modular arithmetic on 64-bit and 128-bit machine words
+ */
+#pragma once
+
+#include <cstdint>
+
+__extension__ typedef unsigned __int128 uint128_t;     // GCC/Clang extension, silenced for -pedantic
+__extension__ typedef __int128 int128_t;
+
+/**
+ * @brief Full 128x128 -> 256 bit product, result returned as (hi,lo) pair of 128-bit words.
+ */
+inline void mul128Wide(uint128_t a, uint128_t b, uint128_t &hi, uint128_t &lo)
+{
+    uint64_t a0 = (uint64_t) a, a1 = (uint64_t) (a >> 64);
+    uint64_t b0 = (uint64_t) b, b1 = (uint64_t) (b >> 64);
+
+    uint128_t p00 = (uint128_t) a0 * b0,
+              p01 = (uint128_t) a0 * b1,
+              p10 = (uint128_t) a1 * b0,
+              p11 = (uint128_t) a1 * b1;
+
+    uint128_t middle = (p00 >> 64) + (uint64_t) p01 + (uint64_t) p10;
+    lo = (middle << 64) | (uint64_t) p00;
+    hi = p11 + (p01 >> 64) + (p10 >> 64) + (middle >> 64);
+}
+
+/**
+ * @brief Arithmetic modulo a word-sized NTT prime p < 2^62.
+ * Variable products use Montgomery reduction (R = 2^64), products with a fixed operand use Shoup's method.
+ */
+struct Modulus64
+{
+    uint64_t p = 0;
+    uint64_t p_neg_inv = 0;     /**< -p^-1 mod 2^64 */
+    uint64_t r_mod = 0;         /**< 2^64 mod p */
+    uint64_t r2_mod = 0;        /**< 2^128 mod p */
+
+    Modulus64() = default;
+
+    explicit Modulus64(uint64_t prime) : p(prime)
+    {
+        uint64_t inv = prime;                   // correct to 3 bits for odd p, each Newton step doubles that
+        for (int i = 0; i < 5; i++)
+            inv *= 2 - prime * inv;
+        p_neg_inv = 0 - inv;
+        r_mod = (uint64_t) (((uint128_t) 1 << 64) % prime);
+        r2_mod = (uint64_t) (((uint128_t) r_mod * r_mod) % prime);
+    }
+
+    /** @brief Montgomery reduction, t < p*2^64, returns t*2^-64 mod p in [0,p) */
+    uint64_t redc(uint128_t t) const
+    {
+        uint64_t m = (uint64_t) t * p_neg_inv;
+        uint64_t r = (uint64_t) ((t + (uint128_t) m * p) >> 64);
+        return r >= p ? r - p : r;
+    }
+
+    /** @brief Reduces an arbitrary 128-bit value modulo p */
+    uint64_t reduce(uint64_t lo, uint64_t hi) const
+    {
+        return add(redc((uint128_t) lo * r_mod), redc((uint128_t) hi * r2_mod));
+    }
+
+    uint64_t add(uint64_t a, uint64_t b) const
+    {
+        uint64_t r = a + b;
+        return r >= p ? r - p : r;
+    }
+
+    uint64_t sub(uint64_t a, uint64_t b) const
+    {
+        return a >= b ? a - b : a + p - b;
+    }
+
+    /** @brief a*b mod p for a,b in [0,p) */
+    uint64_t mul(uint64_t a, uint64_t b) const
+    {
+        return redc((uint128_t) redc((uint128_t) a * b) * r2_mod);
+    }
+
+    /** @brief Precomputed companion floor(w*2^64/p) of a fixed operand w, for use with mulShoup */
+    uint64_t shoup(uint64_t w) const
+    {
+        return (uint64_t) (((uint128_t) w << 64) / p);
+    }
+
+    /** @brief a*w mod p for any 64-bit a and a fixed w in [0,p) with its Shoup companion */
+    uint64_t mulShoup(uint64_t a, uint64_t w, uint64_t w_shoup) const
+    {
+        uint64_t q_hat = (uint64_t) (((uint128_t) a * w_shoup) >> 64);
+        uint64_t r = a * w - q_hat * p;
+        return r >= p ? r - p : r;
+    }
+
+    uint64_t pow(uint64_t base, uint64_t exponent) const
+    {
+        uint64_t result = 1 % p;
+        while (exponent)
+        {
+            if (exponent & 1)
+                result = mul(result, base);
+            base = mul(base, base);
+            exponent >>= 1;
+        }
+        return result;
+    }
+
+    /** @brief Multiplicative inverse, p must be prime */
+    uint64_t inverse(uint64_t a) const
+    {
+        return pow(a, p - 2);
+    }
+};
+
+/**
+ * @brief Arithmetic modulo an odd q < 2^127 held in two 64-bit words, Montgomery reduction with R = 2^128.
+ */
+struct Modulus128
+{
+    uint128_t q = 0;
+    uint128_t q_neg_inv = 0;    /**< -q^-1 mod 2^128 */
+    uint128_t r_mod = 0;        /**< 2^128 mod q */
+    uint128_t r2_mod = 0;       /**< 2^256 mod q */
+
+    Modulus128() = default;
+
+    explicit Modulus128(uint128_t modulus) : q(modulus)
+    {
+        uint128_t inv = modulus;
+        for (int i = 0; i < 6; i++)
+            inv *= 2 - modulus * inv;
+        q_neg_inv = 0 - inv;
+        r_mod = (0 - modulus) % modulus;
+        r2_mod = r_mod;
+        for (int i = 0; i < 128; i++)           // r_mod * 2^128 by doubling, q < 2^127 so no overflow
+            r2_mod = add(r2_mod, r2_mod);
+    }
+
+    /** @brief Montgomery reduction of the 256-bit value (hi,lo) < q*2^128, returns (hi,lo)*2^-128 mod q */
+    uint128_t redc(uint128_t hi, uint128_t lo) const
+    {
+        uint128_t m = lo * q_neg_inv, mq_hi, mq_lo;
+        mul128Wide(m, q, mq_hi, mq_lo);
+        uint128_t carry = (lo + mq_lo) < lo;
+        uint128_t r = hi + mq_hi + carry;
+        return r >= q ? r - q : r;
+    }
+
+    /** @brief a*b*2^-128 mod q */
+    uint128_t mulMontgomery(uint128_t a, uint128_t b) const
+    {
+        uint128_t hi, lo;
+        mul128Wide(a, b, hi, lo);
+        return redc(hi, lo);
+    }
+
+    /** @brief a*b mod q for a,b in [0,q) */
+    uint128_t mul(uint128_t a, uint128_t b) const
+    {
+        return mulMontgomery(mulMontgomery(a, b), r2_mod);
+    }
+
+    /** @brief Converts a value in [0,q) into Montgomery form a*2^128 mod q */
+    uint128_t toMontgomery(uint128_t a) const
+    {
+        return mulMontgomery(a, r2_mod);
+    }
+
+    /** @brief Reduces an arbitrary 128-bit value modulo q, a*2^-128*2^256*2^-128 without any division */
+    uint128_t reduce(uint128_t a) const
+    {
+        return a < q ? a : mulMontgomery(redc(0, a), r2_mod);
+    }
+
+    /** @brief Representative in [0,q) of a signed 64-bit integer */
+    uint128_t fromSigned(int64_t a) const
+    {
+        uint128_t magnitude = reduce(a < 0 ? 0 - (uint64_t) a : (uint64_t) a);
+        return a < 0 ? sub(0, magnitude) : magnitude;
+    }
+
+    uint128_t add(uint128_t a, uint128_t b) const
+    {
+        uint128_t r = a + b;
+        return r >= q ? r - q : r;
+    }
+
+    uint128_t sub(uint128_t a, uint128_t b) const
+    {
+        return a >= b ? a - b : a + q - b;
+    }
+};
@@ -0,0 +1,308 @@
+/**
+ *  Residue number system (RNS) engine for products in Z_q[x]/(x^N+1) using negacyclic NTTs.
+ */
+#include "NTT.hpp"
+#include "RingElement.hpp"
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+
+/**
+ * @brief Deterministic Miller-Rabin primality test for 64-bit odd integers.
+ * @param n candidate
+ */
+static bool isPrime64(uint64_t n)
+{
+    const uint64_t bases[] = {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37};
+    Modulus64 modulus(n);
+    uint64_t d = n - 1;
+    int s = 0;
+    while ((d & 1) == 0)
+    {
+        d >>= 1;
+        s++;
+    }
+    for (uint64_t a : bases)
+    {
+        uint64_t x = modulus.pow(a % n, d);
+        if (x == 1 || x == n - 1)
+            continue;
+        bool composite = true;
+        for (int r = 1; r < s && composite; r++)
+        {
+            x = modulus.mul(x, x);
+            composite = x != n - 1;
+        }
+        if (composite)
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Reverses the lowest 'bits' bits of x.
+ */
+static long bitReverse(long x, int bits)
+{
+    long r = 0;
+    for (int i = 0; i < bits; i++)
+    {
+        r = (r << 1) | (x & 1);
+        x >>= 1;
+    }
+    return r;
+}
+
+/**
+ * @brief Number of significant bits of a 128-bit word.
+ */
+static int bitLength(uint128_t x)
+{
+    int bits = 0;
+    while (x)
+    {
+        bits++;
+        x >>= 1;
+    }
+    return bits;
+}
+
+/**
+ * @brief Sets up the NTT primes and CRT constants for the ring Z_q[x]/(x^N+1).
+ * @param modulus odd modulus q < 2^126
+ * @param degree N, a power of two
+ * Enough primes are chosen so that their product P exceeds 4*N*q^2, which keeps every integer coefficient
+ * of a product of two ring elements (given with coefficients in [0,q)) well inside (-P/4,P/4).
+ */
+RNSEngine::RNSEngine(uint128_t modulus, long degree) : n(degree), log_n(0), modulus_q(modulus), primes(), overflow_mod_q()
+{
+    if ((modulus & 1) == 0 || (modulus >> 126) != 0)
+        throw invalid_argument("RNS engine: modulus q must be odd and smaller than 2^126");
+    if (degree < 2 || (degree & (degree - 1)) != 0)
+        throw invalid_argument("RNS engine: ring degree N must be a power of two");
+    while ((1L << log_n) < n)
+        log_n++;
+
+    /* primes p = 1 mod 2N just below 2^61, each contributes at least 60 bits to P */
+    const int required_bits = log_n + 2 * bitLength(modulus) + 2;
+    const uint64_t step = 2 * (uint64_t) n;
+    for (uint64_t candidate = ((((uint64_t) 1 << 61) - 1) / step) * step + 1;
+         (int) primes.size() * 60 < required_bits; candidate -= step)
+    {
+        if (!isPrime64(candidate))
+            continue;
+
+        NTTPrime prime;
+        prime.modulus = Modulus64(candidate);
+        const Modulus64 &m = prime.modulus;
+
+        /* psi = g^((p-1)/2N) is a primitive 2N-th root of unity as soon as psi^N = -1 */
+        uint64_t psi = 0;
+        for (uint64_t g = 2; psi == 0; g++)
+        {
+            uint64_t root = m.pow(g, (candidate - 1) / step);
+            if (m.pow(root, n) == candidate - 1)
+                psi = root;
+        }
+        uint64_t psi_inv = m.inverse(psi);
+
+        prime.psi_powers.resize(n);
+        prime.psi_powers_shoup.resize(n);
+        prime.psi_inv_powers.resize(n);
+        prime.psi_inv_powers_shoup.resize(n);
+        uint64_t power = 1, inv_power = 1;
+        for (long i = 0; i < n; i++)
+        {
+            long r = bitReverse(i, log_n);
+            prime.psi_powers[r] = power;
+            prime.psi_powers_shoup[r] = m.shoup(power);
+            prime.psi_inv_powers[r] = inv_power;
+            prime.psi_inv_powers_shoup[r] = m.shoup(inv_power);
+            power = m.mul(power, psi);
+            inv_power = m.mul(inv_power, psi_inv);
+        }
+        prime.n_inv = m.inverse(n % candidate);
+        prime.n_inv_shoup = m.shoup(prime.n_inv);
+        prime.inv_p = 1.0 / (double) candidate;
+
+        primes.push_back(prime);
+    }
+
+    /* CRT constants: (P/p_i)^-1 mod p_i, (P/p_i) mod q and multiples of P mod q */
+    uint128_t p_mod_q = 1;
+    for (NTTPrime &prime : primes)
+    {
+        uint64_t factor_mod_p = 1;
+        uint128_t factor_mod_q = 1;
+        for (const NTTPrime &other : primes)
+        {
+            if (&other == &prime)
+                continue;
+            factor_mod_p = prime.modulus.mul(factor_mod_p, other.modulus.p % prime.modulus.p);
+            factor_mod_q = modulus_q.mul(factor_mod_q, modulus_q.reduce(other.modulus.p));
+        }
+        prime.crt_inv = prime.modulus.inverse(factor_mod_p);
+        prime.crt_inv_shoup = prime.modulus.shoup(prime.crt_inv);
+        prime.crt_factor_mod_q = modulus_q.toMontgomery(factor_mod_q);
+        p_mod_q = modulus_q.mul(p_mod_q, modulus_q.reduce(prime.modulus.p));
+    }
+    overflow_mod_q.assign(primes.size() + 1, 0);
+    for (size_t v = 1; v < overflow_mod_q.size(); v++)
+        overflow_mod_q[v] = modulus_q.add(overflow_mod_q[v - 1], p_mod_q);
+}
+
+/**
+ * @brief In-place negacyclic forward NTT (Cooley-Tukey, natural order in, bit-reversed order out).
+ */
+void RNSEngine::forwardNTT(const NTTPrime &prime, uint64_t *a) const
+{
+    const Modulus64 &m = prime.modulus;
+    long t = n;
+    for (long groups = 1; groups < n; groups <<= 1)
+    {
+        t >>= 1;
+        for (long i = 0; i < groups; i++)
+        {
+            const uint64_t w = prime.psi_powers[groups + i], w_shoup = prime.psi_powers_shoup[groups + i];
+            uint64_t *x = a + 2 * i * t, *y = x + t;
+            for (long j = 0; j < t; j++)
+            {
+                uint64_t u = x[j], v = m.mulShoup(y[j], w, w_shoup);
+                x[j] = m.add(u, v);
+                y[j] = m.sub(u, v);
+            }
+        }
+    }
+}
+
+/**
+ * @brief In-place negacyclic inverse NTT (Gentleman-Sande, bit-reversed order in, natural order out), includes N^-1.
+ */
+void RNSEngine::inverseNTT(const NTTPrime &prime, uint64_t *a) const
+{
+    const Modulus64 &m = prime.modulus;
+    long t = 1;
+    for (long groups = n >> 1; groups >= 1; groups >>= 1)
+    {
+        for (long i = 0; i < groups; i++)
+        {
+            const uint64_t w = prime.psi_inv_powers[groups + i], w_shoup = prime.psi_inv_powers_shoup[groups + i];
+            uint64_t *x = a + 2 * i * t, *y = x + t;
+            for (long j = 0; j < t; j++)
+            {
+                uint64_t u = x[j], v = y[j];
+                x[j] = m.add(u, v);
+                y[j] = m.mulShoup(u + m.p - v, w, w_shoup);
+            }
+        }
+        t <<= 1;
+    }
+    for (long j = 0; j < n; j++)
+        a[j] = m.mulShoup(a[j], prime.n_inv, prime.n_inv_shoup);
+}
+
+/**
+ * @brief Maps a ring element into the transform domain.
+ * @param lo low 64 bits of the N coefficients, each coefficient in [0,q)
+ * @param hi high 64 bits of the N coefficients
+ * @param out transform-domain representation
+ */
+void RNSEngine::forward(const uint64_t *lo, const uint64_t *hi, NTTPolynomial &out) const
+{
+    out.residues.resize(primes.size() * n);
+    for (size_t i = 0; i < primes.size(); i++)
+    {
+        const Modulus64 &m = primes[i].modulus;
+        uint64_t *r = &out.residues[i * n];
+        for (long j = 0; j < n; j++)
+            r[j] = m.reduce(lo[j], hi[j]);
+        forwardNTT(primes[i], r);
+    }
+}
+
+/**
+ * @brief Maps a transform-domain element back to coefficients in [0,q).
+ * The exact integer coefficient is recovered as sum(y_i * P/p_i) - v*P, where the overflow count v is the
+ * rounded value of sum(y_i/p_i); it is then reduced mod q without leaving fixed-width arithmetic.
+ * @param in transform-domain representation
+ * @param lo low 64 bits of the N output coefficients
+ * @param hi high 64 bits of the N output coefficients
+ */
+void RNSEngine::inverse(const NTTPolynomial &in, uint64_t *lo, uint64_t *hi) const
+{
+    requireTransform(in, "inverse");
+    std::vector<uint64_t> residues(in.residues);
+    for (size_t i = 0; i < primes.size(); i++)
+        inverseNTT(primes[i], &residues[i * n]);
+
+    for (long j = 0; j < n; j++)
+    {
+        uint128_t coefficient = 0;
+        double overflow = 0;
+        for (size_t i = 0; i < primes.size(); i++)
+        {
+            const NTTPrime &prime = primes[i];
+            uint64_t y = prime.modulus.mulShoup(residues[i * n + j], prime.crt_inv, prime.crt_inv_shoup);
+            overflow += (double) y * prime.inv_p;
+            coefficient = modulus_q.add(coefficient, modulus_q.mulMontgomery(y, prime.crt_factor_mod_q));
+        }
+        coefficient = modulus_q.sub(coefficient, overflow_mod_q[(size_t) llround(overflow)]);
+        lo[j] = (uint64_t) coefficient;
+        hi[j] = (uint64_t) (coefficient >> 64);
+    }
+}
+
+/**
+ * @brief Pointwise product in the transform domain, out may alias a or b.
+ */
+void RNSEngine::multiply(const NTTPolynomial &a, const NTTPolynomial &b, NTTPolynomial &out) const
+{
+    requireTransform(a, "multiply");
+    requireTransform(b, "multiply");
+    out.residues.resize(primes.size() * n);
+    for (size_t i = 0; i < primes.size(); i++)
+    {
+        const Modulus64 &m = primes[i].modulus;
+        for (size_t j = i * n; j < (i + 1) * n; j++)
+            out.residues[j] = m.mul(a.residues[j], b.residues[j]);
+    }
+}
+
+/**
+ * @brief Pointwise multiply-add in the transform domain, acc += a*b.
+ */
+void RNSEngine::multiplyAccumulate(const NTTPolynomial &a, const NTTPolynomial &b, NTTPolynomial &acc) const
+{
+    requireTransform(a, "multiplyAccumulate");
+    requireTransform(b, "multiplyAccumulate");
+    requireTransform(acc, "multiplyAccumulate");
+    for (size_t i = 0; i < primes.size(); i++)
+    {
+        const Modulus64 &m = primes[i].modulus;
+        for (size_t j = i * n; j < (i + 1) * n; j++)
+            acc.residues[j] = m.add(acc.residues[j], m.mul(a.residues[j], b.residues[j]));
+    }
+}
+
+/**
+ * @brief Rejects operands that are not a transform of this engine, e.g. a cached transform that was never computed.
+ * @param a transform-domain operand
+ * @param operation name of the calling operation, used in the error message
+ */
+void RNSEngine::requireTransform(const NTTPolynomial &a, const char *operation) const
+{
+    if (a.residues.size() != primes.size() * n)
+        throw logic_error(string("RNS engine: ") + operation + " on an operand that is not in transform domain");
+}
+
+/**
+ * @brief RNS engine for the OPRF parameters q and N from parameters.hpp, built on first use.
+ */
+const RNSEngine &defaultRNSEngine()
+{
+    static const RNSEngine engine(ringModulus().q, N);
+    return engine;
+}
@@ -0,0 +1,65 @@
+/**
+ *  Residue number system (RNS) engine for products in Z_q[x]/(x^N+1) using negacyclic NTTs.
+ *  q is not NTT-friendly, so ring elements are represented over several 61-bit primes p = 1 mod 2N
+ *  whose product exceeds the largest possible integer coefficient of a product; the result is
+ *  reconstructed exactly with the CRT and reduced mod q.
+ */
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "Modular.hpp"
+
+/**
+ * @brief Precomputed tables of a single NTT prime.
+ */
+struct NTTPrime
+{
+    Modulus64 modulus;
+    std::vector<uint64_t>   psi_powers,             /**< powers of the 2N-th root of unity psi, bit-reversed order */
+                            psi_powers_shoup,
+                            psi_inv_powers,         /**< powers of psi^-1, bit-reversed order */
+                            psi_inv_powers_shoup;
+    uint64_t    n_inv = 0,                          /**< N^-1 mod p */
+                n_inv_shoup = 0,
+                crt_inv = 0,                        /**< (P/p)^-1 mod p, P being the product of all primes */
+                crt_inv_shoup = 0;
+    uint128_t   crt_factor_mod_q = 0;               /**< (P/p) mod q, Montgomery form */
+    double      inv_p = 0;                          /**< 1/p, used to find the CRT overflow count */
+};
+
+/**
+ * @brief Ring element in transform domain: residues of every prime, prime-major (residues[i*N + j]).
+ */
+struct NTTPolynomial
+{
+    std::vector<uint64_t> residues;
+};
+
+class RNSEngine
+{
+public:
+    RNSEngine(uint128_t modulus, long degree);
+
+    void forward(const uint64_t *lo, const uint64_t *hi, NTTPolynomial &out) const;
+    void inverse(const NTTPolynomial &in, uint64_t *lo, uint64_t *hi) const;
+    void multiply(const NTTPolynomial &a, const NTTPolynomial &b, NTTPolynomial &out) const;
+    void multiplyAccumulate(const NTTPolynomial &a, const NTTPolynomial &b, NTTPolynomial &acc) const;
+
+    long degree() const { return n; }
+    std::size_t primeCount() const { return primes.size(); }
+    const Modulus128 &modulusQ() const { return modulus_q; }
+
+private:
+    long n;
+    int log_n;
+    Modulus128 modulus_q;
+    std::vector<NTTPrime> primes;
+    std::vector<uint128_t> overflow_mod_q;          /**< v*P mod q for v = 0..primeCount() */
+
+    void forwardNTT(const NTTPrime &prime, uint64_t *a) const;
+    void inverseNTT(const NTTPrime &prime, uint64_t *a) const;
+    void requireTransform(const NTTPolynomial &a, const char *operation) const;
+};
+
+const RNSEngine &defaultRNSEngine();
@@ -0,0 +1,169 @@
+/**
+ *  Per-thread buffered CSPRNG (AES-256-CTR keystream) used by all OPRF samplers
+ */
+#include "Random.hpp"
+#include <openssl/crypto.h>
+#include <openssl/rand.h>
+#include <atomic>
+#include <cstring>
+#include <stdexcept>
+
+using namespace std;
+
+
+/* deterministic mode, every generator created afterwards is seeded with (seed, index of its stream) */
+static atomic<bool>         deterministic_mode(false);
+static atomic<uint64_t>     deterministic_seed(0);
+static atomic<uint64_t>     deterministic_stream(0);
+
+static void deterministicSeedBytes(uint64_t seed, uint64_t stream, uint8_t out[RandomGenerator::SEED_SIZE])
+{
+    memset(out, 0, RandomGenerator::SEED_SIZE);
+    for (int i = 0; i < 8; i++)
+    {
+        out[i] = (uint8_t) (seed >> (8 * i));
+        out[8 + i] = (uint8_t) (stream >> (8 * i));
+    }
+}
+
+/**
+ * @brief Generator seeded from the operating system, or from the deterministic seed if that mode is enabled.
+ */
+RandomGenerator::RandomGenerator() : context(EVP_CIPHER_CTX_new()), buffer(), position(BUFFER_SIZE)
+{
+    uint8_t seed[SEED_SIZE];
+    if (deterministic_mode)
+        deterministicSeedBytes(deterministic_seed, deterministic_stream++, seed);
+    else if (RAND_bytes(seed, SEED_SIZE) != 1)
+        throw runtime_error("RandomGenerator: could not obtain a seed from the system");
+    reseed(seed);
+    OPENSSL_cleanse(seed, SEED_SIZE);
+}
+
+/**
+ * @brief Generator with a fixed seed, produces the same stream on every run.
+ * @param seed 32 bytes used as AES-256 key
+ */
+RandomGenerator::RandomGenerator(const uint8_t seed[SEED_SIZE]) : context(EVP_CIPHER_CTX_new()), buffer(), position(BUFFER_SIZE)
+{
+    reseed(seed);
+}
+
+RandomGenerator::~RandomGenerator()
+{
+    OPENSSL_cleanse(buffer, BUFFER_SIZE);
+    EVP_CIPHER_CTX_free(context);
+}
+
+/**
+ * @brief Restarts the keystream from a new seed, buffered output of the previous seed is discarded.
+ * @param seed 32 bytes used as AES-256 key
+ */
+void RandomGenerator::reseed(const uint8_t seed[SEED_SIZE])
+{
+    const uint8_t iv[16] = {0};
+    if (context == nullptr || EVP_EncryptInit_ex(context, EVP_aes_256_ctr(), nullptr, seed, iv) != 1)
+        throw runtime_error("RandomGenerator: AES-256-CTR initialization failed");
+    OPENSSL_cleanse(buffer, BUFFER_SIZE);
+    position = BUFFER_SIZE;
+}
+
+/**
+ * @brief Encrypts a zero block in place, which yields the next BUFFER_SIZE keystream bytes.
+ */
+void RandomGenerator::refill()
+{
+    int length = 0;
+    memset(buffer, 0, BUFFER_SIZE);
+    if (EVP_EncryptUpdate(context, buffer, &length, buffer, (int) BUFFER_SIZE) != 1 || length != (int) BUFFER_SIZE)
+        throw runtime_error("RandomGenerator: keystream generation failed");
+    position = 0;
+}
+
+void RandomGenerator::fill(uint8_t *out, size_t length)
+{
+    while (length > 0)
+    {
+        if (position == BUFFER_SIZE)
+            refill();
+        size_t chunk = min(length, BUFFER_SIZE - position);
+        memcpy(out, buffer + position, chunk);
+        position += chunk;
+        out += chunk;
+        length -= chunk;
+    }
+}
+
+uint64_t RandomGenerator::next64()
+{
+    uint64_t value;
+    if (position + sizeof(value) <= BUFFER_SIZE)
+    {
+        memcpy(&value, buffer + position, sizeof(value));
+        position += sizeof(value);
+    }
+    else
+        fill((uint8_t *) &value, sizeof(value));
+    return value;
+}
+
+/**
+ * @brief Uniform integer in [0,bound) by masked rejection sampling, bound > 0.
+ */
+uint64_t RandomGenerator::uniform(uint64_t bound)
+{
+    uint64_t mask = bound - 1;
+    for (int shift = 1; shift < 64; shift <<= 1)
+        mask |= mask >> shift;
+    uint64_t value;
+    do
+        value = next64() & mask;
+    while (value >= bound);
+    return value;
+}
+
+/**
+ * @brief Uniform integer in [0,bound) by masked rejection sampling, bound > 0.
+ */
+uint128_t RandomGenerator::uniform128(uint128_t bound)
+{
+    uint128_t mask = bound - 1;
+    for (int shift = 1; shift < 128; shift <<= 1)
+        mask |= mask >> shift;
+    uint128_t value;
+    do
+    {
+        value = next64();
+        if (mask >> 64)
+            value |= (uint128_t) next64() << 64;
+        value &= mask;
+    } while (value >= bound);
+    return value;
+}
+
+/**
+ * @brief Generator of the calling thread, created on first use.
+ */
+RandomGenerator &RandomGenerator::threadLocal()
+{
+    static thread_local RandomGenerator generator;
+    return generator;
+}
+
+/**
+ * @brief Enables the deterministic mode for reproducible benchmarks, never use it for real sessions.
+ * @param seed benchmark seed
+ * The calling thread's generator is reseeded with stream 0, generators of threads started afterwards
+ * get streams 1, 2, ... in order of their first use.
+ */
+void RandomGenerator::setDeterministicSeed(uint64_t seed)
+{
+    RandomGenerator &generator = threadLocal();
+    deterministic_seed = seed;
+    deterministic_stream = 0;
+    deterministic_mode = true;
+
+    uint8_t seed_bytes[SEED_SIZE];
+    deterministicSeedBytes(seed, deterministic_stream++, seed_bytes);
+    generator.reseed(seed_bytes);
+}
@@ -0,0 +1,45 @@
+/**
+ *  Per-thread buffered CSPRNG (AES-256-CTR keystream) used by all OPRF samplers
+ */
+#pragma once
+
+#include <openssl/evp.h>
+#include <cstddef>
+#include <cstdint>
+#include "Modular.hpp"
+
+/**
+ * @brief AES-256-CTR keystream generator, the key being the 32-byte seed.
+ * Keystream is produced in blocks of BUFFER_SIZE bytes and handed out from the buffer, so samplers pay for
+ * one cipher call per few thousand coefficients instead of a system call per polynomial.
+ * Every thread owns its own generator, obtained through threadLocal().
+ */
+class RandomGenerator
+{
+public:
+    static const std::size_t SEED_SIZE = 32;
+    static const std::size_t BUFFER_SIZE = 4096;
+
+    RandomGenerator();
+    explicit RandomGenerator(const uint8_t seed[SEED_SIZE]);
+    ~RandomGenerator();
+
+    RandomGenerator(const RandomGenerator &) = delete;
+    RandomGenerator &operator=(const RandomGenerator &) = delete;
+
+    void reseed(const uint8_t seed[SEED_SIZE]);
+    void fill(uint8_t *out, std::size_t length);
+    uint64_t next64();
+    uint64_t uniform(uint64_t bound);
+    uint128_t uniform128(uint128_t bound);
+
+    static RandomGenerator &threadLocal();
+    static void setDeterministicSeed(uint64_t seed);
+
+private:
+    EVP_CIPHER_CTX *context;
+    uint8_t buffer[BUFFER_SIZE];
+    std::size_t position;
+
+    void refill();
+};
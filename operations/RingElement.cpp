@@ -0,0 +1,223 @@
+/**
+ *  Compact ring element of Z_q[x]/(x^N+1) with fixed-width coefficients
+ */
+#include "RingElement.hpp"
+#include "NTT.hpp"
+
+using namespace std;
+using namespace NTL;
+
+
+/**
+ * @brief Converts a non-negative integer smaller than 2^128 from NTL representation.
+ * @param value integer of type ZZ
+ */
+uint128_t ZZToWord128(const ZZ &value)
+{
+    unsigned char bytes[16];
+    BytesFromZZ(bytes, value, 16);
+    uint128_t word = 0;
+    for (int i = 15; i >= 0; i--)
+        word = (word << 8) | bytes[i];
+    return word;
+}
+
+/**
+ * @brief Converts a 128-bit word into NTL representation.
+ * @param word unsigned 128-bit integer
+ */
+ZZ word128ToZZ(uint128_t word)
+{
+    unsigned char bytes[16];
+    for (int i = 0; i < 16; i++)
+        bytes[i] = (unsigned char) (word >> (8 * i));
+    return ZZFromBytes(bytes, 16);
+}
+
+/**
+ * @brief Fixed-width arithmetic modulo the OPRF parameter q from parameters.hpp, set up on first use.
+ */
+const Modulus128 &ringModulus()
+{
+    static const Modulus128 modulus(ZZToWord128(q));
+    return modulus;
+}
+
+/**
+ * @brief Captures the moduli q and x^N+1, the calling thread's current moduli are left untouched.
+ */
+RingContext::RingContext() : zz_p_context(q)
+{
+    ZZ_pPush push(zz_p_context);        // x^N+1 has to be built over Z_q
+    ZZ_pX cyclotomic(INIT_MONO, N);
+    SetCoeff(cyclotomic, 0, 1);
+    zz_pE_context = ZZ_pEContext(cyclotomic);
+}
+
+/**
+ * @brief Makes this context current on the calling thread, without restoring anything afterwards.
+ */
+void RingContext::install() const
+{
+    zz_p_context.restore();
+    zz_pE_context.restore();
+}
+
+/**
+ * @brief Context of the OPRF ring from parameters.hpp, created on first use, shared by all threads.
+ */
+const RingContext &RingContext::shared()
+{
+    static const RingContext context;
+    return context;
+}
+
+RingContextGuard::RingContextGuard(const RingContext &context)
+    : zz_p_push(context.zz_p_context), zz_pE_push(context.zz_pE_context)
+{
+}
+
+RingElement &RingElement::operator+=(const RingElement &other)
+{
+    const Modulus128 &modulus = ringModulus();
+    for (long i = 0; i < N; i++)
+        setCoefficient(i, modulus.add(coefficient(i), other.coefficient(i)));
+    return *this;
+}
+
+RingElement &RingElement::operator-=(const RingElement &other)
+{
+    const Modulus128 &modulus = ringModulus();
+    for (long i = 0; i < N; i++)
+        setCoefficient(i, modulus.sub(coefficient(i), other.coefficient(i)));
+    return *this;
+}
+
+/**
+ * @brief Overwrites the coefficients with zeroes in a way the compiler cannot optimize away, used for secret values.
+ */
+void RingElement::zeroize()
+{
+    volatile uint64_t *words = &coefficients[0][0];
+    for (long i = 0; i < 2 * N; i++)
+        words[i] = 0;
+}
+
+/**
+ * @brief Constructs a ring element from its NTL representation.
+ * @param polynomial polynomial in the ring, its coefficients are read without an installed context
+ */
+RingElement RingElement::fromZZ_pE(const ZZ_pE &polynomial)
+{
+    RingElement element;
+    const ZZ_pX &polynomial_rep = rep(polynomial);
+    for (long i = 0; i <= deg(polynomial_rep); i++)
+        element.setCoefficient(i, ZZToWord128(rep(polynomial_rep[i])));
+    return element;
+}
+
+/**
+ * @brief Converts the ring element into NTL representation, a RingContext must be installed on the calling thread.
+ */
+ZZ_pE RingElement::toZZ_pE() const
+{
+    ZZ_pX polynomial;
+    polynomial.SetLength(N);
+    for (long i = 0; i < N; i++)
+        conv(polynomial[i], word128ToZZ(coefficient(i)));
+    polynomial.normalize();
+
+    return conv<ZZ_pE>(polynomial);
+}
+
+RingElement operator+(const RingElement &a, const RingElement &b)
+{
+    RingElement sum(a);
+    sum += b;
+    return sum;
+}
+
+RingElement operator-(const RingElement &a, const RingElement &b)
+{
+    RingElement difference(a);
+    difference -= b;
+    return difference;
+}
+
+bool operator==(const RingElement &a, const RingElement &b)
+{
+    for (long i = 0; i < N; i++)
+        if (a.coefficients[0][i] != b.coefficients[0][i] || a.coefficients[1][i] != b.coefficients[1][i])
+            return false;
+    return true;
+}
+
+bool operator!=(const RingElement &a, const RingElement &b)
+{
+    return !(a == b);
+}
+
+/**
+ * @brief Product of two ring elements of Z_q[x]/(x^N+1), computed with the RNS/NTT engine.
+ * @param a polynomial in the ring
+ * @param b polynomial in the ring
+ */
+RingElement ringMultiply(const RingElement &a, const RingElement &b)
+{
+    const RNSEngine &engine = defaultRNSEngine();
+    NTTPolynomial a_ntt, b_ntt;
+    RingElement product;
+
+    engine.forward(a.low(), a.high(), a_ntt);
+    engine.forward(b.low(), b.high(), b_ntt);
+    engine.multiply(a_ntt, b_ntt, a_ntt);
+    engine.inverse(a_ntt, product.low(), product.high());
+
+    return product;
+}
+
+/**
+ * @brief Product with an operand that is already in transform domain, saves one forward transform.
+ * @param a polynomial in the ring
+ * @param b_ntt polynomial in the ring, transformed by ringTransform()
+ */
+RingElement ringMultiply(const RingElement &a, const NTTPolynomial &b_ntt)
+{
+    const RNSEngine &engine = defaultRNSEngine();
+    NTTPolynomial a_ntt;
+    RingElement product;
+
+    engine.forward(a.low(), a.high(), a_ntt);
+    engine.multiply(a_ntt, b_ntt, a_ntt);
+    engine.inverse(a_ntt, product.low(), product.high());
+
+    return product;
+}
+
+/**
+ * @brief Product of two operands already in transform domain, only the inverse transform is computed.
+ * @param a_ntt polynomial in the ring, transformed by ringTransform()
+ * @param b_ntt polynomial in the ring, transformed by ringTransform()
+ */
+RingElement ringMultiply(const NTTPolynomial &a_ntt, const NTTPolynomial &b_ntt)
+{
+    const RNSEngine &engine = defaultRNSEngine();
+    NTTPolynomial product_ntt;
+    RingElement product;
+
+    engine.multiply(a_ntt, b_ntt, product_ntt);
+    engine.inverse(product_ntt, product.low(), product.high());
+
+    return product;
+}
+
+/**
+ * @brief Transform-domain (RNS/NTT) copy of a ring element, for operands reused in several products.
+ * @param a polynomial in the ring
+ */
+NTTPolynomial ringTransform(const RingElement &a)
+{
+    NTTPolynomial a_ntt;
+    defaultRNSEngine().forward(a.low(), a.high(), a_ntt);
+    return a_ntt;
+}
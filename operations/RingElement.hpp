@@ -0,0 +1,107 @@
+/**
+ *  Compact ring element of Z_q[x]/(x^N+1) with fixed-width coefficients
+ */
+#pragma once
+
+#include <NTL/ZZ_pE.h>
+#include <cstdint>
+#include "Modular.hpp"
+#include "NTT.hpp"
+#include "../parameters.hpp"
+
+/**
+ * @brief Element of Z_q[x]/(x^N+1), q < 2^126, stored as one contiguous block of machine words
+ * instead of N+1 heap-allocated NTL integers.
+ * Coefficient i is coefficients[1][i]*2^64 + coefficients[0][i] and is always kept in [0,q).
+ */
+class RingElement
+{
+public:
+    alignas(32) uint64_t coefficients[2][N];    /**< [0] low words, [1] high words of the N coefficients */
+
+    RingElement() : coefficients() {}
+
+    uint128_t coefficient(long i) const
+    {
+        return ((uint128_t) coefficients[1][i] << 64) | coefficients[0][i];
+    }
+
+    void setCoefficient(long i, uint128_t value)
+    {
+        coefficients[0][i] = (uint64_t) value;
+        coefficients[1][i] = (uint64_t) (value >> 64);
+    }
+
+    const uint64_t *low() const { return coefficients[0]; }
+    const uint64_t *high() const { return coefficients[1]; }
+    uint64_t *low() { return coefficients[0]; }
+    uint64_t *high() { return coefficients[1]; }
+
+    RingElement &operator+=(const RingElement &other);
+    RingElement &operator-=(const RingElement &other);
+
+    void zeroize();
+
+    static RingElement fromZZ_pE(const NTL::ZZ_pE &polynomial);
+    NTL::ZZ_pE toZZ_pE() const;
+};
+
+RingElement operator+(const RingElement &a, const RingElement &b);
+
+RingElement operator-(const RingElement &a, const RingElement &b);
+
+bool operator==(const RingElement &a, const RingElement &b);
+
+bool operator!=(const RingElement &a, const RingElement &b);
+
+RingElement ringMultiply(const RingElement &a, const RingElement &b);
+
+RingElement ringMultiply(const RingElement &a, const NTTPolynomial &b_ntt);
+
+RingElement ringMultiply(const NTTPolynomial &a_ntt, const NTTPolynomial &b_ntt);
+
+NTTPolynomial ringTransform(const RingElement &a);
+
+const Modulus128 &ringModulus();
+
+uint128_t ZZToWord128(const NTL::ZZ &value);
+
+NTL::ZZ word128ToZZ(uint128_t word);
+
+/**
+ * @brief NTL moduli of the ring (ZZ_p modulo q, ZZ_pE modulo x^N+1), built once and installed per thread.
+ * NTL keeps the current moduli per thread, so every thread that converts to or from ZZ_pE installs the
+ * context itself, with install() or for a scope with RingContextGuard. RingElement arithmetic, the samplers
+ * and the OPRF steps of Client and Evaluator work on machine words and need no installed context.
+ */
+class RingContext
+{
+public:
+    RingContext();
+
+    void install() const;
+
+    static const RingContext &shared();
+
+private:
+    friend class RingContextGuard;
+
+    NTL::ZZ_pContext zz_p_context;
+    NTL::ZZ_pEContext zz_pE_context;
+};
+
+/**
+ * @brief Installs a ring context on the calling thread for the lifetime of the guard, then restores the previous moduli.
+ */
+class RingContextGuard
+{
+public:
+    explicit RingContextGuard(const RingContext &context = RingContext::shared());
+
+    RingContextGuard(const RingContextGuard &) = delete;
+    RingContextGuard &operator=(const RingContextGuard &) = delete;
+
+private:
+    NTL::ZZ_pPush zz_p_push;
+    NTL::ZZ_pEPush zz_pE_push;
+};
@@ -0,0 +1,200 @@
+/**
+ *  Exact integer rounding from Z_q to Z_2 (p = 2) with bit-packed results
+ */
+#include "Rounding.hpp"
+#include <immintrin.h>
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+using namespace NTL;
+
+
+/**
+ * @brief Thresholds of the rounding, the coefficient u in [0,q) being compared against them.
+ * round(centered(u)/(q/2)) with ties rounded down is 1 for floor(q/4) < u <= floor(q/2), -1 for
+ * floor(q/2) < u <= floor(3q/4) and 0 otherwise; q is odd, so ties cannot occur.
+ */
+struct RoundingThresholds
+{
+    uint128_t quarter, half, three_quarters;
+
+    RoundingThresholds()
+    {
+        const uint128_t q_word = ringModulus().q;
+        quarter = q_word / 4;
+        half = q_word / 2;
+        three_quarters = (3 * q_word) / 4;
+    }
+};
+
+static const RoundingThresholds &roundingThresholds()
+{
+    static const RoundingThresholds thresholds;
+    return thresholds;
+}
+
+/**
+ * @brief Scalar kernel, one 64-bit word of both bit planes per 64 coefficients.
+ */
+static void roundingWords(const uint64_t *low, const uint64_t *high, long count, uint64_t *parity, uint64_t *sign)
+{
+    const RoundingThresholds &t = roundingThresholds();
+    for (long w = 0; w * 64 < count; w++)
+    {
+        uint64_t parity_word = 0, sign_word = 0;
+        for (long b = 0; b < 64 && w * 64 + b < count; b++)
+        {
+            long i = w * 64 + b;
+            uint128_t u = ((uint128_t) high[i] << 64) | low[i];
+            uint64_t bit = (u > t.quarter) & (u <= t.three_quarters);
+            parity_word |= bit << b;
+            sign_word |= (bit & (u > t.half)) << b;
+        }
+        parity[w] = parity_word;
+        sign[w] = sign_word;
+    }
+}
+
+/**
+ * @brief Lane mask of u > threshold for four 128-bit values split into (hi,lo) words, unsigned comparison.
+ */
+__attribute__((target("avx2")))
+static inline __m256i greaterThan128(__m256i hi, __m256i lo, __m256i t_hi, __m256i t_lo, __m256i flip)
+{
+    __m256i hi_flipped = _mm256_xor_si256(hi, flip), lo_flipped = _mm256_xor_si256(lo, flip);
+    __m256i hi_greater = _mm256_cmpgt_epi64(hi_flipped, t_hi),
+            hi_equal = _mm256_cmpeq_epi64(hi_flipped, t_hi),
+            lo_greater = _mm256_cmpgt_epi64(lo_flipped, t_lo);
+    return _mm256_or_si256(hi_greater, _mm256_and_si256(hi_equal, lo_greater));
+}
+
+/**
+ * @brief AVX2 kernel, four coefficients per comparison, count must be a multiple of 64.
+ * Thresholds are stored with the sign bit flipped so that signed 64-bit comparisons order them as unsigned.
+ */
+__attribute__((target("avx2")))
+static void roundingWordsAVX2(const uint64_t *low, const uint64_t *high, long count, uint64_t *parity, uint64_t *sign)
+{
+    const RoundingThresholds &t = roundingThresholds();
+    const uint64_t flip_bit = 1ULL << 63;
+    const __m256i flip = _mm256_set1_epi64x((long long) flip_bit);
+    const __m256i quarter_hi = _mm256_set1_epi64x((long long) ((uint64_t) (t.quarter >> 64) ^ flip_bit)),
+                  quarter_lo = _mm256_set1_epi64x((long long) ((uint64_t) t.quarter ^ flip_bit)),
+                  half_hi = _mm256_set1_epi64x((long long) ((uint64_t) (t.half >> 64) ^ flip_bit)),
+                  half_lo = _mm256_set1_epi64x((long long) ((uint64_t) t.half ^ flip_bit)),
+                  three_quarters_hi = _mm256_set1_epi64x((long long) ((uint64_t) (t.three_quarters >> 64) ^ flip_bit)),
+                  three_quarters_lo = _mm256_set1_epi64x((long long) ((uint64_t) t.three_quarters ^ flip_bit));
+
+    for (long w = 0; w * 64 < count; w++)
+    {
+        uint64_t parity_word = 0, sign_word = 0;
+        for (int b = 0; b < 64; b += 4)
+        {
+            long i = w * 64 + b;
+            __m256i lo = _mm256_loadu_si256((const __m256i *) (low + i)),
+                    hi = _mm256_loadu_si256((const __m256i *) (high + i));
+            __m256i above_quarter = greaterThan128(hi, lo, quarter_hi, quarter_lo, flip),
+                    above_half = greaterThan128(hi, lo, half_hi, half_lo, flip),
+                    above_three_quarters = greaterThan128(hi, lo, three_quarters_hi, three_quarters_lo, flip);
+            __m256i bit = _mm256_andnot_si256(above_three_quarters, above_quarter);
+            parity_word |= (uint64_t) _mm256_movemask_pd(_mm256_castsi256_pd(bit)) << b;
+            sign_word |= (uint64_t) _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_and_si256(bit, above_half))) << b;
+        }
+        parity[w] = parity_word;
+        sign[w] = sign_word;
+    }
+}
+
+/**
+ * @brief Rounds every coefficient of a ring element exactly, without leaving integer arithmetic.
+ * @param polynom polynomial in the ring
+ * @param rounded output bit planes
+ * @param kernel kernel to use, the default picks the fastest one available; requesting AVX2 throws
+ * invalid_argument if the CPU or N does not allow it
+ */
+void roundingPacked(const RingElement &polynom, RoundedPolynomial &rounded, RoundingKernel kernel)
+{
+    const bool avx2 = N % 64 == 0 && __builtin_cpu_supports("avx2");
+    if (kernel == RoundingKernel::AVX2 && !avx2)
+        throw invalid_argument("roundingPacked: AVX2 kernel not available");
+
+    if (kernel == RoundingKernel::AVX2 || (kernel == RoundingKernel::Auto && avx2))
+        roundingWordsAVX2(polynom.low(), polynom.high(), N, rounded.parity, rounded.sign);
+    else
+        roundingWords(polynom.low(), polynom.high(), N, rounded.parity, rounded.sign);
+}
+
+RoundedPolynomial roundingPacked(const RingElement &polynom)
+{
+    RoundedPolynomial rounded;
+    roundingPacked(polynom, rounded);
+    return rounded;
+}
+
+/**
+ * @brief Client finalization, rounds y = d_x - c*s without materializing y.
+ * The difference is formed 64 coefficients at a time in a stack block and rounded while it is still in L1.
+ * @param d_x blinded evaluation received from the evaluator
+ * @param c_s product of the evaluator's commitment c and the client's blinding value s
+ * @param rounded output bit planes
+ */
+void unblindAndRound(const RingElement &d_x, const RingElement &c_s, RoundedPolynomial &rounded)
+{
+    const uint128_t q_word = ringModulus().q;
+    const bool avx2 = N % 64 == 0 && __builtin_cpu_supports("avx2");
+    alignas(32) uint64_t low[64], high[64];
+
+    for (long w = 0; w < RoundedPolynomial::WORDS; w++)
+    {
+        long count = min<long>(64, N - w * 64);
+        for (long b = 0; b < count; b++)
+        {
+            uint128_t d = d_x.coefficient(w * 64 + b), cs = c_s.coefficient(w * 64 + b);
+            uint128_t u = d >= cs ? d - cs : d + (q_word - cs);
+            low[b] = (uint64_t) u;
+            high[b] = (uint64_t) (u >> 64);
+        }
+        if (avx2)
+            roundingWordsAVX2(low, high, count, rounded.parity + w, rounded.sign + w);
+        else
+            roundingWords(low, high, count, rounded.parity + w, rounded.sign + w);
+    }
+}
+
+/**
+ * @brief Converts the bit planes into the NTL polynomial returned by rounding() (normalized, coefficients -1, 0, 1).
+ */
+ZZX RoundedPolynomial::toZZX() const
+{
+    ZZX polynomial;
+    polynomial.SetLength(N);
+    for (long i = 0; i < N; i++)
+        polynomial[i] = coefficient(i);
+    polynomial.normalize();
+    return polynomial;
+}
+
+bool operator==(const RoundedPolynomial &a, const RoundedPolynomial &b)
+{
+    for (long w = 0; w < RoundedPolynomial::WORDS; w++)
+        if (a.parity[w] != b.parity[w] || a.sign[w] != b.sign[w])
+            return false;
+    return true;
+}
+
+bool operator!=(const RoundedPolynomial &a, const RoundedPolynomial &b)
+{
+    return !(a == b);
+}
+
+/**
+ * @brief Number of coefficients on which two rounded polynomials differ mod p = 2, XOR and popcount per word.
+ */
+long parityMismatches(const RoundedPolynomial &a, const RoundedPolynomial &b)
+{
+    long mismatches = 0;
+    for (long w = 0; w < RoundedPolynomial::WORDS; w++)
+        mismatches += __builtin_popcountll(a.parity[w] ^ b.parity[w]);
+    return mismatches;
+}
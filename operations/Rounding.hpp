@@ -0,0 +1,52 @@
+/**
+ *  Exact integer rounding from Z_q to Z_2 (p = 2) with bit-packed results
+ */
+#pragma once
+
+#include <NTL/ZZX.h>
+#include <cstdint>
+#include "RingElement.hpp"
+
+/**
+ * @brief Rounded ring element, coefficients in {-1,0,1} stored as two bit planes of N bits.
+ * Bit i of parity is the rounded value mod p = 2, bit i of sign is set for the coefficients equal to -1.
+ */
+struct RoundedPolynomial
+{
+    static const long WORDS = (N + 63) / 64;
+
+    uint64_t parity[WORDS];
+    uint64_t sign[WORDS];
+
+    RoundedPolynomial() : parity(), sign() {}
+
+    int coefficient(long i) const
+    {
+        int bit = (int) ((parity[i / 64] >> (i % 64)) & 1);
+        return ((sign[i / 64] >> (i % 64)) & 1) ? -bit : bit;
+    }
+
+    NTL::ZZX toZZX() const;
+};
+
+/**
+ * @brief Kernel used by roundingPacked(), Auto picks AVX2 when the CPU supports it.
+ */
+enum class RoundingKernel
+{
+    Auto,
+    Scalar,
+    AVX2
+};
+
+bool operator==(const RoundedPolynomial &a, const RoundedPolynomial &b);
+
+bool operator!=(const RoundedPolynomial &a, const RoundedPolynomial &b);
+
+long parityMismatches(const RoundedPolynomial &a, const RoundedPolynomial &b);
+
+void roundingPacked(const RingElement &polynom, RoundedPolynomial &rounded, RoundingKernel kernel = RoundingKernel::Auto);
+
+RoundedPolynomial roundingPacked(const RingElement &polynom);
+
+void unblindAndRound(const RingElement &d_x, const RingElement &c_s, RoundedPolynomial &rounded);
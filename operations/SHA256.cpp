@@ -0,0 +1,311 @@
+/**
+ *  SHA256 hashing: reusable incremental contexts with binary digests, and a multi-buffer backend
+ *  hashing eight independent messages per AVX2 pass with a scalar fallback
+ */
+#include "SHA256.hpp"
+#include <immintrin.h>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+
+
+static const uint32_t ROUND_CONSTANTS[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static const uint32_t INITIAL_STATE[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+SHA256Context::SHA256Context() : context(EVP_MD_CTX_new())
+{
+    reset();
+}
+
+SHA256Context::~SHA256Context()
+{
+    EVP_MD_CTX_free(context);
+}
+
+/**
+ * @brief Discards any absorbed data and starts a new message.
+ */
+SHA256Context &SHA256Context::reset()
+{
+    if (context == nullptr || EVP_DigestInit_ex(context, EVP_sha256(), nullptr) != 1)
+        throw runtime_error("SHA256Context: initialization failed");
+    return *this;
+}
+
+SHA256Context &SHA256Context::update(const uint8_t *data, size_t length)
+{
+    if (EVP_DigestUpdate(context, data, length) != 1)
+        throw runtime_error("SHA256Context: update failed");
+    return *this;
+}
+
+/**
+ * @brief Writes the digest of the absorbed data and resets the context.
+ * @param digest output, SHA256_DIGEST_SIZE bytes
+ */
+void SHA256Context::finish(uint8_t *digest)
+{
+    unsigned int length = 0;
+    if (EVP_DigestFinal_ex(context, digest, &length) != 1 || length != SHA256_DIGEST_SIZE)
+        throw runtime_error("SHA256Context: finalization failed");
+    reset();
+}
+
+SHA256Digest SHA256Context::finish()
+{
+    SHA256Digest digest;
+    finish(digest.data());
+    return digest;
+}
+
+/**
+ * @brief Context of the calling thread, created on first use.
+ * The context is returned as it is, so a message in progress is never discarded behind its owner's back.
+ * Callers start with reset(), which also drops whatever a hash abandoned by an exception left behind.
+ */
+SHA256Context &SHA256Context::threadLocal()
+{
+    static thread_local SHA256Context context;
+    return context;
+}
+
+/**
+ * @brief Lowercase hexadecimal form of a byte string, meant for display and for the legacy string formats.
+ */
+string toHex(const uint8_t *bytes, size_t length)
+{
+    static const char hex_digits[] = "0123456789abcdef";
+    string hex(2 * length, '0');
+    for (size_t i = 0; i < length; i++)
+    {
+        hex[2 * i] = hex_digits[bytes[i] >> 4];
+        hex[2 * i + 1] = hex_digits[bytes[i] & 15];
+    }
+    return hex;
+}
+
+string toHex(const SHA256Digest &digest)
+{
+    return toHex(digest.data(), digest.size());
+}
+
+/* number of messages hashed together by the AVX2 kernel */
+static const size_t LANES = 8;
+
+static inline uint32_t loadBigEndian(const uint8_t *bytes)
+{
+    return ((uint32_t) bytes[0] << 24) | ((uint32_t) bytes[1] << 16) | ((uint32_t) bytes[2] << 8) | bytes[3];
+}
+
+static inline void storeBigEndian(uint8_t *bytes, uint32_t word)
+{
+    bytes[0] = (uint8_t) (word >> 24);
+    bytes[1] = (uint8_t) (word >> 16);
+    bytes[2] = (uint8_t) (word >> 8);
+    bytes[3] = (uint8_t) word;
+}
+
+static inline uint32_t rotr(uint32_t x, int n)
+{
+    return (x >> n) | (x << (32 - n));
+}
+
+/**
+ * @brief Number of 64-byte blocks of a padded message (message, 0x80, zeroes, 64-bit bit length).
+ */
+static inline size_t paddedBlocks(size_t length)
+{
+    return (length + 9 + 63) / 64;
+}
+
+/**
+ * @brief Writes the padded message into blocks, which must hold paddedBlocks(length) * 64 bytes.
+ * @param total_length length encoded in the padding, larger than length if only the tail of a message is padded
+ */
+static void padMessage(const uint8_t *message, size_t length, uint8_t *blocks, size_t total_length)
+{
+    size_t padded_length = paddedBlocks(length) * 64;
+    memcpy(blocks, message, length);
+    memset(blocks + length, 0, padded_length - length);
+    blocks[length] = 0x80;
+    uint64_t bit_length = (uint64_t) total_length * 8;
+    for (int b = 0; b < 8; b++)
+        blocks[padded_length - 1 - b] = (uint8_t) (bit_length >> (8 * b));
+}
+
+/**
+ * @brief Scalar compression function, one block into one state.
+ */
+static void compressBlock(uint32_t state[8], const uint8_t *block)
+{
+    uint32_t w[64];
+    for (int t = 0; t < 16; t++)
+        w[t] = loadBigEndian(block + 4 * t);
+    for (int t = 16; t < 64; t++)
+    {
+        uint32_t s0 = rotr(w[t - 15], 7) ^ rotr(w[t - 15], 18) ^ (w[t - 15] >> 3),
+                 s1 = rotr(w[t - 2], 17) ^ rotr(w[t - 2], 19) ^ (w[t - 2] >> 10);
+        w[t] = w[t - 16] + s0 + w[t - 7] + s1;
+    }
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3],
+             e = state[4], f = state[5], g = state[6], h = state[7];
+    for (int t = 0; t < 64; t++)
+    {
+        uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + ROUND_CONSTANTS[t] + w[t],
+                 t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+    state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+    state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+/**
+ * @brief SHA256 of a single message, same digest as EVP_sha256().
+ * @param message input bytes
+ * @param length number of input bytes
+ * @param digest output, SHA256_DIGEST_SIZE bytes
+ */
+void sha256(const uint8_t *message, size_t length, uint8_t *digest)
+{
+    uint32_t state[8];
+    memcpy(state, INITIAL_STATE, sizeof(state));
+
+    /* whole blocks are compressed in place, only the tail is padded on the stack */
+    size_t whole = length / 64 * 64;
+    for (size_t offset = 0; offset < whole; offset += 64)
+        compressBlock(state, message + offset);
+    uint8_t tail[128];
+    padMessage(message + whole, length - whole, tail, length);
+    for (size_t offset = 0; offset < paddedBlocks(length - whole) * 64; offset += 64)
+        compressBlock(state, tail + offset);
+    for (int i = 0; i < 8; i++)
+        storeBigEndian(digest + 4 * i, state[i]);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i rotr8(__m256i x, int n)
+{
+    return _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - n));
+}
+
+/**
+ * @brief AVX2 compression function, lane l of the state absorbs the block at blocks[l].
+ * Lanes outside active_mask (all-ones 32-bit lanes) keep their previous state.
+ */
+__attribute__((target("avx2")))
+static void compressBlocks8(__m256i state[8], const uint8_t *const blocks[LANES], __m256i active_mask)
+{
+    __m256i w[64];
+    for (int t = 0; t < 16; t++)
+        w[t] = _mm256_setr_epi32((int) loadBigEndian(blocks[0] + 4 * t), (int) loadBigEndian(blocks[1] + 4 * t),
+                                 (int) loadBigEndian(blocks[2] + 4 * t), (int) loadBigEndian(blocks[3] + 4 * t),
+                                 (int) loadBigEndian(blocks[4] + 4 * t), (int) loadBigEndian(blocks[5] + 4 * t),
+                                 (int) loadBigEndian(blocks[6] + 4 * t), (int) loadBigEndian(blocks[7] + 4 * t));
+    for (int t = 16; t < 64; t++)
+    {
+        __m256i s0 = _mm256_xor_si256(_mm256_xor_si256(rotr8(w[t - 15], 7), rotr8(w[t - 15], 18)),
+                                      _mm256_srli_epi32(w[t - 15], 3)),
+                s1 = _mm256_xor_si256(_mm256_xor_si256(rotr8(w[t - 2], 17), rotr8(w[t - 2], 19)),
+                                      _mm256_srli_epi32(w[t - 2], 10));
+        w[t] = _mm256_add_epi32(_mm256_add_epi32(w[t - 16], s0), _mm256_add_epi32(w[t - 7], s1));
+    }
+
+    __m256i a = state[0], b = state[1], c = state[2], d = state[3],
+            e = state[4], f = state[5], g = state[6], h = state[7];
+    for (int t = 0; t < 64; t++)
+    {
+        __m256i sigma1 = _mm256_xor_si256(_mm256_xor_si256(rotr8(e, 6), rotr8(e, 11)), rotr8(e, 25)),
+                choice = _mm256_xor_si256(_mm256_and_si256(e, f), _mm256_andnot_si256(e, g)),
+                sigma0 = _mm256_xor_si256(_mm256_xor_si256(rotr8(a, 2), rotr8(a, 13)), rotr8(a, 22)),
+                majority = _mm256_xor_si256(_mm256_xor_si256(_mm256_and_si256(a, b), _mm256_and_si256(a, c)),
+                                            _mm256_and_si256(b, c));
+        __m256i t1 = _mm256_add_epi32(_mm256_add_epi32(h, sigma1),
+                                      _mm256_add_epi32(choice, _mm256_add_epi32(_mm256_set1_epi32((int) ROUND_CONSTANTS[t]), w[t]))),
+                t2 = _mm256_add_epi32(sigma0, majority);
+        h = g; g = f; f = e; e = _mm256_add_epi32(d, t1);
+        d = c; c = b; b = a; a = _mm256_add_epi32(t1, t2);
+    }
+
+    __m256i rounds[8] = {a, b, c, d, e, f, g, h};
+    for (int i = 0; i < 8; i++)
+        state[i] = _mm256_blendv_epi8(state[i], _mm256_add_epi32(state[i], rounds[i]), active_mask);
+}
+
+/**
+ * @brief Hashes up to LANES messages together, lanes with fewer blocks are masked out of the later blocks.
+ */
+__attribute__((target("avx2")))
+static void sha256Lanes(const uint8_t *const *messages, const size_t *lengths, size_t count, uint8_t *digests)
+{
+    size_t blocks[LANES] = {}, max_blocks = 0;
+    for (size_t l = 0; l < count; l++)
+    {
+        blocks[l] = paddedBlocks(lengths[l]);
+        max_blocks = max(max_blocks, blocks[l]);
+    }
+
+    vector<uint8_t> padded(LANES * max_blocks * 64, 0);
+    for (size_t l = 0; l < count; l++)
+        padMessage(messages[l], lengths[l], padded.data() + l * max_blocks * 64, lengths[l]);
+
+    __m256i state[8];
+    for (int i = 0; i < 8; i++)
+        state[i] = _mm256_set1_epi32((int) INITIAL_STATE[i]);
+
+    for (size_t block = 0; block < max_blocks; block++)
+    {
+        const uint8_t *lane_blocks[LANES];
+        int active[LANES];
+        for (size_t l = 0; l < LANES; l++)
+        {
+            lane_blocks[l] = padded.data() + (l * max_blocks + block) * 64;
+            active[l] = block < blocks[l] ? -1 : 0;
+        }
+        compressBlocks8(state, lane_blocks, _mm256_loadu_si256((const __m256i *) active));
+    }
+
+    uint32_t words[8][LANES];
+    for (int i = 0; i < 8; i++)
+        _mm256_storeu_si256((__m256i *) words[i], state[i]);
+    for (size_t l = 0; l < count; l++)
+        for (int i = 0; i < 8; i++)
+            storeBigEndian(digests + l * SHA256_DIGEST_SIZE + 4 * i, words[i][l]);
+}
+
+/**
+ * @brief SHA256 of many independent messages, digests written in binary one after the other.
+ * @param messages pointers to the messages
+ * @param lengths byte lengths of the messages
+ * @param count number of messages
+ * @param digests output, count * SHA256_DIGEST_SIZE bytes
+ * With AVX2 the messages are hashed LANES at a time, each 32-bit lane carrying one message's state.
+ */
+void sha256Many(const uint8_t *const *messages, const size_t *lengths, size_t count, uint8_t *digests)
+{
+    if (!__builtin_cpu_supports("avx2"))
+    {
+        for (size_t i = 0; i < count; i++)
+            sha256(messages[i], lengths[i], digests + i * SHA256_DIGEST_SIZE);
+        return;
+    }
+
+    for (size_t i = 0; i < count; i += LANES)
+        sha256Lanes(messages + i, lengths + i, min(LANES, count - i), digests + i * SHA256_DIGEST_SIZE);
+}
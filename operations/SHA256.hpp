@@ -0,0 +1,57 @@
+/**
+ *  SHA256 hashing: reusable incremental contexts with binary digests, and a multi-buffer backend
+ *  hashing eight independent messages per AVX2 pass with a scalar fallback
+ */
+#pragma once
+
+#include <openssl/evp.h>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+const std::size_t SHA256_DIGEST_SIZE = 32;
+
+typedef std::array<uint8_t, SHA256_DIGEST_SIZE> SHA256Digest;
+
+/**
+ * @brief Incremental SHA256 over byte spans, the OpenSSL context is allocated once and reused.
+ * finish() resets the context, so one object hashes any number of messages in sequence.
+ * Every thread owns a context, obtained through threadLocal(). It is not reentrant: a message has to be finished
+ * before anything that hashes through threadLocal() is called, code that can run in the middle of another
+ * message uses its own SHA256Context.
+ */
+class SHA256Context
+{
+public:
+    SHA256Context();
+    ~SHA256Context();
+
+    SHA256Context(const SHA256Context &) = delete;
+    SHA256Context &operator=(const SHA256Context &) = delete;
+
+    SHA256Context &reset();
+    SHA256Context &update(const uint8_t *data, std::size_t length);
+    void finish(uint8_t *digest);
+    SHA256Digest finish();
+
+    /** @brief Absorbs any contiguous byte container (std::string, std::vector<uint8_t>, oqs::bytes, SHA256Digest) */
+    template <class Bytes>
+    SHA256Context &update(const Bytes &bytes)
+    {
+        return update(reinterpret_cast<const uint8_t *>(bytes.data()), bytes.size() * sizeof(*bytes.data()));
+    }
+
+    static SHA256Context &threadLocal();
+
+private:
+    EVP_MD_CTX *context;
+};
+
+std::string toHex(const uint8_t *bytes, std::size_t length);
+
+std::string toHex(const SHA256Digest &digest);
+
+void sha256(const uint8_t *message, std::size_t length, uint8_t *digest);
+
+void sha256Many(const uint8_t *const *messages, const std::size_t *lengths, std::size_t count, uint8_t *digests);
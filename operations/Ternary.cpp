@@ -0,0 +1,147 @@
+/**
+ *  Dense x ternary negacyclic products for the ternary OPRF values (k, e, s, e')
+ */
+#include "Ternary.hpp"
+#include <immintrin.h>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+
+
+/* every dense coefficient is split into two limbs of LIMB_BITS bits, so that N of them can be summed in an int64_t */
+static const int        LIMB_BITS = 62 - hr_N;
+static const int64_t    LIMB_MASK = ((int64_t) 1 << LIMB_BITS) - 1;
+static const size_t     BLOCK = 8;      /**< number of rotated copies added per pass over the accumulator */
+
+/**
+ * @brief Converts a ring element with coefficients in {0,1,q-1} into a ternary polynomial.
+ * @param element polynomial in the ring
+ */
+TernaryPolynomial TernaryPolynomial::fromRingElement(const RingElement &element)
+{
+    const uint128_t q_minus_one = ringModulus().q - 1;
+    TernaryPolynomial ternary;
+    for (long i = 0; i < N; i++)
+    {
+        uint128_t c = element.coefficient(i);
+        if (c == 0 || c == 1)
+            ternary.coefficients[i] = (int8_t) c;
+        else if (c == q_minus_one)
+            ternary.coefficients[i] = -1;
+        else
+            throw invalid_argument("ternaryMultiply: operand coefficients must be in {-1,0,1}");
+    }
+    return ternary;
+}
+
+RingElement TernaryPolynomial::toRingElement() const
+{
+    const Modulus128 &modulus = ringModulus();
+    RingElement element;
+    for (long i = 0; i < N; i++)
+        element.setCoefficient(i, modulus.fromSigned(coefficients[i]));
+    return element;
+}
+
+/**
+ * @brief acc[i] += sum of the rotated copies sources[b][i], scalar version.
+ */
+static void accumulateRotations(int64_t *acc, const int64_t *const *sources, size_t count, bool subtract)
+{
+    for (size_t b = 0; b < count; b++)
+    {
+        const int64_t *source = sources[b];
+        if (subtract)
+            for (long i = 0; i < N; i++)
+                acc[i] -= source[i];
+        else
+            for (long i = 0; i < N; i++)
+                acc[i] += source[i];
+    }
+}
+
+/**
+ * @brief acc[i] += sum of the rotated copies sources[b][i], four 64-bit lanes at a time, one load/store of acc per block.
+ */
+__attribute__((target("avx2")))
+static void accumulateRotationsAVX2(int64_t *acc, const int64_t *const *sources, size_t count, bool subtract)
+{
+    for (long i = 0; i < N; i += 4)
+    {
+        __m256i sum = _mm256_loadu_si256((const __m256i *) (sources[0] + i));
+        for (size_t b = 1; b < count; b++)
+            sum = _mm256_add_epi64(sum, _mm256_loadu_si256((const __m256i *) (sources[b] + i)));
+        __m256i a = _mm256_loadu_si256((const __m256i *) (acc + i));
+        a = subtract ? _mm256_sub_epi64(a, sum) : _mm256_add_epi64(a, sum);
+        _mm256_storeu_si256((__m256i *) (acc + i), a);
+    }
+}
+
+/**
+ * @brief Negacyclic product of a dense ring element and a ternary one, using additions and subtractions only.
+ * @param dense polynomial in the ring
+ * @param ternary polynomial with coefficients in {-1,0,1}
+ * With ext = (-a, a), coefficient k of the product is sum_j t_j * ext[N+k-j], so every non-zero t_j adds or
+ * subtracts one contiguous slice of ext to the accumulator. Coefficients are split into two limbs whose sums
+ * over N terms fit an int64_t, hence nothing is reduced mod q until the final recombination.
+ */
+RingElement ternaryMultiply(const RingElement &dense, const TernaryPolynomial &ternary)
+{
+    const Modulus128 &modulus = ringModulus();
+    if ((modulus.q >> (2 * LIMB_BITS)) != 0)
+        return ringMultiply(dense, ternary.toRingElement());   // limbs would overflow, q > 2^(2*LIMB_BITS)
+
+    const bool use_avx2 = __builtin_cpu_supports("avx2");
+    vector<int64_t> ext(4 * N), acc(2 * N, 0);
+    int64_t *ext_limbs[2] = {&ext[0], &ext[2 * N]}, *acc_limbs[2] = {&acc[0], &acc[N]};
+    for (long i = 0; i < N; i++)
+    {
+        uint128_t c = dense.coefficient(i);
+        int64_t limbs[2] = {(int64_t) c & LIMB_MASK, (int64_t) (c >> LIMB_BITS)};
+        for (int l = 0; l < 2; l++)
+        {
+            ext_limbs[l][i] = -limbs[l];
+            ext_limbs[l][N + i] = limbs[l];
+        }
+    }
+
+    vector<long> positive, negative;
+    for (long j = 0; j < N; j++)
+    {
+        if (ternary.coefficients[j] == 1)
+            positive.push_back(j);
+        else if (ternary.coefficients[j] == -1)
+            negative.push_back(j);
+    }
+
+    for (int l = 0; l < 2; l++)
+    {
+        for (int sign = 0; sign < 2; sign++)
+        {
+            const vector<long> &indices = sign ? negative : positive;
+            for (size_t start = 0; start < indices.size(); start += BLOCK)
+            {
+                const int64_t *sources[BLOCK];
+                size_t count = min(BLOCK, indices.size() - start);
+                for (size_t b = 0; b < count; b++)
+                    sources[b] = ext_limbs[l] + N - indices[start + b];
+                if (use_avx2)
+                    accumulateRotationsAVX2(acc_limbs[l], sources, count, sign);
+                else
+                    accumulateRotations(acc_limbs[l], sources, count, sign);
+            }
+        }
+    }
+
+    /* recombination hi*2^LIMB_BITS + lo fits a signed 128-bit integer */
+    RingElement product;
+    for (long i = 0; i < N; i++)
+    {
+        int128_t value = ((int128_t) acc_limbs[1][i] << LIMB_BITS) + acc_limbs[0][i];
+        uint128_t magnitude = modulus.reduce((uint128_t) (value < 0 ? -value : value));
+        product.setCoefficient(i, value < 0 ? modulus.sub(0, magnitude) : magnitude);
+    }
+
+    return product;
+}
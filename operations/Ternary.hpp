@@ -0,0 +1,22 @@
+/**
+ *  Dense x ternary negacyclic products for the ternary OPRF values (k, e, s, e')
+ */
+#pragma once
+
+#include <cstdint>
+#include "RingElement.hpp"
+
+/**
+ * @brief Ring element with coefficients in {-1,0,1}, as produced by sampleSmallUniformPolynomial(-1, 1).
+ */
+struct TernaryPolynomial
+{
+    int8_t coefficients[N];
+
+    TernaryPolynomial() : coefficients() {}
+
+    static TernaryPolynomial fromRingElement(const RingElement &element);
+    RingElement toRingElement() const;
+};
+
+RingElement ternaryMultiply(const RingElement &dense, const TernaryPolynomial &ternary);
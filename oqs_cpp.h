@@ -366,6 +366,107 @@ class KeyEncapsulation {
         return shared_secret;
     }
 
+    /**
+     * \brief Generate public key/secret key pair into a caller-provided buffer
+     * \param public_key Public key, resized only if its size is wrong
+     * \note The secret key buffer of the object is reused, no allocation
+     * happens once both buffers have the right size
+     */
+    void generate_keypair(bytes& public_key) {
+        public_key.resize(alg_details_.length_public_key);
+        secret_key_.resize(alg_details_.length_secret_key);
+
+        OQS_STATUS rv_ = C::OQS_KEM_keypair(kem_.get(), public_key.data(),
+                                            secret_key_.data());
+        if (rv_ != OQS_STATUS::OQS_SUCCESS)
+            throw std::runtime_error("Can not generate keypair");
+    }
+
+    /**
+     * \brief Generate public key/secret key pair from a seed into a
+     * caller-provided buffer
+     * \param key_input Seed
+     * \param public_key Public key, resized only if its size is wrong
+     */
+    void generate_keypair_based_on_input(uint8_t *key_input, bytes& public_key) {
+        public_key.resize(alg_details_.length_public_key);
+        secret_key_.resize(alg_details_.length_secret_key);
+
+        OQS_STATUS rv_ = C::OQS_KEM_keypair_based_on_input(key_input, kem_.get(), public_key.data(),
+                                            secret_key_.data());
+        if (rv_ != OQS_STATUS::OQS_SUCCESS)
+            throw std::runtime_error("Can not generate keypair");
+    }
+
+    /**
+     * \brief Encapsulate secret into caller-provided buffers
+     * \param public_key Public key
+     * \param ciphertext Ciphertext, resized only if its size is wrong
+     * \param shared_secret Shared secret, resized only if its size is wrong
+     */
+    void encap_secret(const bytes& public_key, bytes& ciphertext,
+                      bytes& shared_secret) const {
+        if (public_key.size() != alg_details_.length_public_key)
+            throw std::runtime_error("Incorrect public key length");
+
+        ciphertext.resize(alg_details_.length_ciphertext);
+        shared_secret.resize(alg_details_.length_shared_secret);
+        OQS_STATUS rv_ =
+            C::OQS_KEM_encaps(kem_.get(), ciphertext.data(),
+                              shared_secret.data(), public_key.data());
+        if (rv_ != OQS_STATUS::OQS_SUCCESS)
+            throw std::runtime_error("Can not encapsulate secret");
+    }
+
+    /**
+     * \brief Decapsulate secret into a caller-provided buffer
+     * \param ciphertext Ciphertext
+     * \param shared_secret Shared secret, resized only if its size is wrong
+     */
+    void decap_secret(const bytes& ciphertext, bytes& shared_secret) const {
+        if (ciphertext.size() != alg_details_.length_ciphertext)
+            throw std::runtime_error("Incorrect ciphertext length");
+
+        if (secret_key_.size() != alg_details_.length_secret_key)
+            throw std::runtime_error(
+                "Incorrect secret key length, make sure you "
+                "specify one in the constructor or run "
+                "oqs::Signature::generate_keypair()");
+
+        shared_secret.resize(alg_details_.length_shared_secret);
+        OQS_STATUS rv_ =
+            C::OQS_KEM_decaps(kem_.get(), shared_secret.data(),
+                              ciphertext.data(), secret_key_.data());
+
+        if (rv_ != OQS_STATUS::OQS_SUCCESS)
+            throw std::runtime_error("Can not decapsulate secret");
+    }
+
+    /**
+     * \brief Secret key without copying it
+     * \return Reference to the secret key, valid until the next key
+     * generation or the destruction of the object
+     */
+    const bytes& view_secret_key() const { return secret_key_; }
+
+    /**
+     * \brief Replace the secret key, reusing the existing buffer
+     * \param secret_key Secret key
+     */
+    void import_secret_key(const bytes& secret_key) {
+        if (secret_key.size() != alg_details_.length_secret_key)
+            throw std::runtime_error("Incorrect secret key length");
+        secret_key_.resize(alg_details_.length_secret_key);
+        std::copy(secret_key.begin(), secret_key.end(), secret_key_.begin());
+    }
+
+    /**
+     * \brief Cleanse the secret key, the buffer keeps its size
+     */
+    void cleanse_secret_key() {
+        C::OQS_MEM_cleanse(secret_key_.data(), secret_key_.size());
+    }
+
     /**
      * \brief std::ostream extraction operator for the KEM algorithm details
      * \param os Output stream
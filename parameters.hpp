@@ -13,7 +13,7 @@ const int           hr_N = 12;    /**< human readable N value, to which power is
 
 /* DO NOT EDIT THESE VALUES - the above set values are used as exponents to set the true values here */
 const NTL::ZZ       q   = NTL::NextPrime(NTL::power(NTL::conv<NTL::ZZ>(2),hr_q));
-const long          N   = NTL::conv<long>(NTL::power(NTL::conv<NTL::ZZ>(2),hr_N));
+const long          N   = 1L << hr_N;    // compile-time constant, sizes the fixed-width ring element storage
 const int           sec = 40;
 const NTL::ZZ       B   = NTL::conv<NTL::ZZ>(2)*NTL::conv<NTL::ZZ>(N)*NTL::power(NTL::conv<NTL::ZZ>(2),sec);  //2N*2^sec
 const std::string   hr_B = "2^"+ std::to_string(hr_N+1+sec);    // used just for printing
@@ -0,0 +1,89 @@
+/**
+ *  Offline precomputation of the client's blinding material
+ */
+#include "BlindingQueue.hpp"
+#include "../operations/Crypto.hpp"
+
+
+/**
+ * @brief Empty queue for the public value a.
+ * @param a_ntt transform of a, as published by the evaluator (Evaluator::a_ntt)
+ * @param capacity maximum number of precomputed tuples
+ */
+BlindingQueue::BlindingQueue(const NTTPolynomial &a_ntt, std::size_t capacity)
+    : a_ntt(a_ntt), max_size(capacity), mutex(), tuples()
+{
+}
+
+/**
+ * @brief Samples s and e' as ternary polynomials and computes a*s + e'.
+ * @param a_ntt transform of the public value a
+ */
+BlindingTuple BlindingQueue::compute(const NTTPolynomial &a_ntt)
+{
+    BlindingTuple tuple;
+    sampleSmallUniformPolynomial(-1, 1, tuple.s);
+    sampleSmallUniformPolynomial(-1, 1, tuple.e_prime);
+    tuple.s_ntt = ringTransform(tuple.s);
+    tuple.a_s_e_prime = ringMultiply(a_ntt, tuple.s_ntt)+tuple.e_prime;
+    return tuple;
+}
+
+/**
+ * @brief Precomputes tuples until the queue is full, the products run outside the lock.
+ * Returns the number of tuples added by this call.
+ */
+std::size_t BlindingQueue::fill()
+{
+    std::size_t added = 0;
+    for (;;)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (tuples.size() + in_progress >= max_size)
+                return added;
+            in_progress++;
+        }
+
+        BlindingTuple tuple = compute(a_ntt);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tuples.push_back(std::move(tuple));
+            in_progress--;
+        }
+        tuple.s.zeroize();                  // RingElement moves are copies, clear the secret values left behind
+        tuple.e_prime.zeroize();
+        added++;
+    }
+}
+
+/**
+ * @brief Oldest precomputed tuple, computed on the spot if none is ready.
+ */
+BlindingTuple BlindingQueue::pop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!tuples.empty())
+        {
+            BlindingTuple tuple = std::move(tuples.front());
+            tuples.front().s.zeroize();         // RingElement moves are copies, clear the secret values left behind
+            tuples.front().e_prime.zeroize();
+            tuples.pop_front();
+            return tuple;
+        }
+    }
+    return compute(a_ntt);
+}
+
+std::size_t BlindingQueue::size() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return tuples.size();
+}
+
+std::size_t BlindingQueue::capacity() const
+{
+    return max_size;
+}
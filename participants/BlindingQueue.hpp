@@ -0,0 +1,48 @@
+/**
+ *  Offline precomputation of the client's blinding material
+ */
+#pragma once
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include "../operations/RingElement.hpp"
+
+/**
+ * @brief Blinding values of one OPRF session, independent of the biometric input.
+ */
+struct BlindingTuple
+{
+    RingElement     s,
+                    e_prime,
+                    a_s_e_prime;    /**< a*s + e', the client only adds a_x online */
+    NTTPolynomial   s_ntt;          /**< transform of s, reused for unblinding */
+};
+
+/**
+ * @brief Bounded queue of blinding tuples for a fixed public value a.
+ * fill() precomputes tuples up to the capacity and may run on a background thread while the fingerprint is
+ * being captured; pop() hands out a precomputed tuple, or computes one on the spot if the queue is empty.
+ */
+class BlindingQueue
+{
+public:
+    BlindingQueue(const NTTPolynomial &a_ntt, std::size_t capacity);
+
+    BlindingQueue(const BlindingQueue &) = delete;
+    BlindingQueue &operator=(const BlindingQueue &) = delete;
+
+    std::size_t fill();
+    BlindingTuple pop();
+    std::size_t size() const;
+    std::size_t capacity() const;
+
+    static BlindingTuple compute(const NTTPolynomial &a_ntt);
+
+private:
+    const NTTPolynomial a_ntt;
+    const std::size_t max_size;
+
+    mutable std::mutex mutex;
+    std::deque<BlindingTuple> tuples;
+    std::size_t in_progress = 0;     /**< tuples being computed by fill(), counted against the capacity */
+};
@@ -11,27 +11,73 @@
     * @brief Computes a_x value in modified OPRF protocol based on the secret polynomial stored in the Client object.
     * Takes the coefficients of the secret polynomial, concatenates them - thereby creating h,
     * then new coefficients (a0...aN) are created by hashing "0h","1h","2h"..."nh",
-    * lastly converting the hashes to integers and performing a 'mod q' operation.
+    * lastly converting the hashes to integers and performing a 'mod q' operation (see hashCoefficientsToRing()).
+    * In HashToRingMode::XOF the coefficients are instead sampled from a single SHAKE128 stream by hashToRing().
     */
-NTL::ZZ_pE Client::compute_a_x()
+RingElement Client::compute_a_x()
 {
-    std::vector<std::string> hashed_coefficients = hashCoefficients(secret_polynomial);
+    RingElement a_x_polynomial;
 
-    NTL::ZZ a_x_coeff[N+1];     // N+1 element array because of number of coefficients in polynomial
-    NTL::ZZ_pE a_x_polynomial;
-
-    for(int i=0; i<=N; i++)
-    {
-        /* creates a_x coefficients by hashing the biometric data polynomial */
-        a_x_coeff[i] = hashDigestToIntegerModQ(hashed_coefficients[i]);
-    }
-    /* converts array of coefficients to ring element (ZZ_pE polynomial) */
-    a_x_polynomial = spawnRingPolynomial(a_x_coeff);
+    if (hash_to_ring_mode == HashToRingMode::XOF)
+        hashToRing(secret_polynomial, a_x_polynomial);
+    else
+        hashCoefficientsToRing(secret_polynomial, a_x_polynomial);   // multi-buffer SHA256, same result as before
 
     return a_x_polynomial;
 }
 
-NTL::ZZ_pE Client::compute_c_x(const NTL::ZZ_pE& a)
+/**
+    * @brief Computes c_x = a*s + e' + a_x, keeping the transform of s for compute_y and finalize.
+    * @param a public value a
+    */
+RingElement Client::compute_c_x(const RingElement& a)
+{
+    s_ntt = ringTransform(s);
+    return ringMultiply(a, s_ntt)+e_prime+a_x;
+}
+
+/**
+    * @brief Computes c_x from the evaluator's cached transform of a, keeping the transform of s for compute_y.
+    * @param a_ntt transform of the public value a
+    */
+RingElement Client::compute_c_x(const NTTPolynomial& a_ntt)
+{
+    s_ntt = ringTransform(s);
+    return ringMultiply(a_ntt, s_ntt)+e_prime+a_x;
+}
+
+/**
+    * @brief Computes c_x from precomputed blinding material, online only a_x is added.
+    * @param blinding tuple from a BlindingQueue built for the evaluator's a, s, e' and the transform of s are kept
+    */
+RingElement Client::compute_c_x(BlindingTuple&& blinding)
+{
+    s = blinding.s;
+    e_prime = blinding.e_prime;
+    s_ntt = std::move(blinding.s_ntt);
+    blinding.s.zeroize();
+    blinding.e_prime.zeroize();
+    return blinding.a_s_e_prime+a_x;
+}
+
+/**
+    * @brief Unblinds d_x, y = d_x - c*s, using the transform of s from compute_c_x.
+    * @param c_ntt transform of the evaluator's commitment c
+    * Throws std::logic_error if compute_c_x was not called before.
+    */
+RingElement Client::compute_y(const NTTPolynomial& c_ntt)
+{
+    return d_x-ringMultiply(c_ntt, s_ntt);
+}
+
+/**
+    * @brief Fused unblinding and rounding, y = d_x - c*s is rounded straight into y_packed.
+    * @param c_ntt transform of the evaluator's commitment c
+    * @param kem_seed if not null, receives the KEM_SEED_SIZE byte seed hashed from y_packed as set by kem_seed_mode
+    */
+void Client::finalize(const NTTPolynomial& c_ntt, uint8_t* kem_seed)
 {
-    return (a*s)+e_prime+a_x;
+    unblindAndRound(d_x, ringMultiply(c_ntt, s_ntt), y_packed);
+    if (kem_seed != nullptr)
+        hashRoundedPolynomial(y_packed, kem_seed, kem_seed_mode);
 }
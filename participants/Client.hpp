@@ -3,22 +3,52 @@
  */
 #pragma once
 #include <NTL/ZZX.h>
-#include <NTL/ZZ_pE.h>
 #include "../oqs_cpp.h"
+#include "../operations/RingElement.hpp"
+#include "../operations/Rounding.hpp"
+#include "BlindingQueue.hpp"
+#include "../operations/Random.hpp"
 #include "../fuzzyVault/Thimble.hpp"
 
+/**
+ * @brief How compute_a_x maps the secret polynomial onto the ring.
+ */
+enum class HashToRingMode
+{
+    Legacy,     /**< N+1 SHA256 digests of "ih", reduced mod q and folded by x^N = -1 */
+    XOF         /**< one SHAKE128 stream, coefficients sampled mod q by rejection */
+};
+
+/**
+ * @brief How the rounded OPRF output is turned into the KEM key generation seed.
+ */
+enum class KEMSeedMode
+{
+    Legacy,     /**< first 32 hex characters of SHA256 over the decimal coefficients */
+    Packed      /**< SHA256 over the bit-packed output mod 2 */
+};
+
 class Client
 {
 public:
-    NTL::ZZ_pE compute_a_x();
-    NTL::ZZ_pE compute_c_x(const NTL::ZZ_pE& a);
+    HashToRingMode hash_to_ring_mode = HashToRingMode::Legacy;    /**< Legacy keeps existing enrollments valid */
+    KEMSeedMode kem_seed_mode = KEMSeedMode::Legacy;    /**< Legacy keeps existing enrollments valid */
+
+    RingElement compute_a_x();
+    RingElement compute_c_x(const RingElement& a);
+    RingElement compute_c_x(const NTTPolynomial& a_ntt);
+    RingElement compute_c_x(BlindingTuple&& blinding);
+    RingElement compute_y(const NTTPolynomial& c_ntt);
+    void finalize(const NTTPolynomial& c_ntt, uint8_t* kem_seed = nullptr);
 
-    NTL::ZZX secret_polynomial, y_rounded;
-    NTL::ZZ_pE  s,
+    NTL::ZZX secret_polynomial, y_rounded;     /**< y_rounded (and y) are only filled by OPRFWithTimings */
+    RoundedPolynomial y_packed;                 /**< rounded OPRF output, filled by finalize() */
+    RingElement s,
                 e_prime,
                 d_x,
                 a_x,
                 y;
+    NTTPolynomial s_ntt;        /**< transform of s, shared by compute_c_x and compute_y */
 
     oqs::bytes  public_key,
                 secret_key,
@@ -35,7 +65,7 @@ public:
     {
         for (int i=0; i<16; i++)
         {
-            SetCoeff(secret_polynomial, i, NTL::RandomBnd(pow(2,18)));
+            SetCoeff(secret_polynomial, i, (long) RandomGenerator::threadLocal().uniform(1 << 18));
         }
         secret_polynomial.normalize();  // strips leading zeroes
     }
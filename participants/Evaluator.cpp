@@ -1,9 +1,125 @@
 #include "Evaluator.hpp"
+#include <thread>
+#include "../operations/Crypto.hpp"
+#include "../operations/Random.hpp"
 
-NTL::ZZ_pE Evaluator::compute_d_x() {
-    return (c_x*k)+E;
+/**
+ * @brief Computes d_x = c_x*k + E with the cached transform of k.
+ * Requires commit(), throws std::logic_error otherwise.
+ */
+RingElement Evaluator::compute_d_x() {
+    return ringMultiply(c_x, k_ntt)+E;
 }
 
-NTL::ZZ_pE Evaluator::compute_c(NTL::ZZ_pE a) {
-    return (a*k)+e;
+/**
+ * @brief Evaluates one blinded input, d_x = c_x*k + E, the noise E being local to the call.
+ * @param c_x blinded input of the client
+ * Requires commit(), throws std::logic_error otherwise. Only reads the evaluator, so concurrent sessions can
+ * share one evaluator.
+ */
+RingElement Evaluator::evaluate(const RingElement& c_x) const {
+    RingElement noise;
+    sampleBigUniformPolynomial(B, noise);
+    RingElement d_x = ringMultiply(c_x, k_ntt)+noise;
+    noise.zeroize();
+    return d_x;
+}
+
+/**
+ * @brief Evaluates one blinded input with pre-sampled noise, d_x = c_x*k + E with E taken from the pool.
+ * @param c_x blinded input of the client
+ * @param noise_pool pool of flooding noise, E is used for this call only and zeroized afterwards
+ * Requires commit(), throws std::logic_error otherwise. If the pool keeps E in transform domain, c_x*k is accumulated onto it before the single
+ * inverse transform, so sampling and adding E cost nothing at request time. The CRT reconstruction has room for
+ * the extra q, see RNSEngine.
+ */
+RingElement Evaluator::evaluate(const RingElement& c_x, NoisePool& noise_pool) const {
+    FloodingNoise noise = noise_pool.take();
+    RingElement d_x;
+    if (noise_pool.transformDomain()) {
+        const RNSEngine &engine = defaultRNSEngine();
+        NTTPolynomial c_x_ntt;
+        engine.forward(c_x.low(), c_x.high(), c_x_ntt);
+        engine.multiplyAccumulate(c_x_ntt, k_ntt, noise.transform);
+        engine.inverse(noise.transform, d_x.low(), d_x.high());
+    } else {
+        d_x = ringMultiply(c_x, k_ntt)+noise.coefficients;
+    }
+    noise.zeroize();
+    return d_x;
+}
+
+RingElement Evaluator::compute_c(const RingElement& a) {
+    return ringMultiply(a, k)+e;
+}
+
+/**
+ * @brief Draws a fresh seed and expands the public value a from it.
+ */
+void Evaluator::generate_a_seed() {
+    a_seed.resize(A_SEED_SIZE);
+    RandomGenerator::threadLocal().fill(a_seed.data(), a_seed.size());
+    a = expandPublicPolynomial(a_seed.data());
+}
+
+/**
+ * @brief Restores a from a published seed, e.g. when loading a stored commitment.
+ * @param seed A_SEED_SIZE bytes
+ */
+void Evaluator::load_a_seed(const uint8_t* seed) {
+    a_seed.assign(seed, seed + A_SEED_SIZE);
+    a = expandPublicPolynomial(a_seed.data());
+}
+
+/**
+ * @brief Caches the transforms of the published values a, c and the key k, must be called whenever they change.
+ * Every following session reuses them instead of transforming the commitment again.
+ */
+void Evaluator::commit() {
+    a_ntt = ringTransform(a);
+    k_ntt = ringTransform(k);
+    c_ntt = ringTransform(c);
+}
+
+/**
+ * @brief Evaluates many blinded inputs at once, d_x[i] = c_x[i]*k + E_i with fresh noise E_i for every request.
+ * @param c_x_batch blinded inputs of the clients
+ * @param thread_count number of worker threads, 0 uses all hardware threads
+ * Requires commit(). The noise is sampled up front from the calling thread's generator, so it does not depend
+ * on how the batch is split, which keeps deterministic benchmark runs reproducible. The batch is then split
+ * into contiguous chunks, each worker reuses one transform buffer and one product buffer for its whole chunk
+ * and shares the cached transform of k.
+ */
+std::vector<RingElement> Evaluator::compute_d_x_batch(const std::vector<RingElement>& c_x_batch, unsigned thread_count) const {
+    std::vector<RingElement> d_x_batch(c_x_batch.size());
+    if (thread_count == 0)
+        thread_count = std::max(1u, std::thread::hardware_concurrency());
+    thread_count = std::min<size_t>(thread_count, c_x_batch.size());
+
+    /* d_x[i] starts out as the noise E_i, the workers only add the products */
+    for (auto &d_x : d_x_batch)
+        sampleBigUniformPolynomial(B, d_x);
+
+    auto evaluate_chunk = [&](size_t begin, size_t end) {
+        const RNSEngine &engine = defaultRNSEngine();
+        NTTPolynomial c_x_ntt;
+        RingElement product;
+        for (size_t i = begin; i < end; i++) {
+            engine.forward(c_x_batch[i].low(), c_x_batch[i].high(), c_x_ntt);
+            engine.multiply(c_x_ntt, k_ntt, c_x_ntt);
+            engine.inverse(c_x_ntt, product.low(), product.high());
+            d_x_batch[i] += product;
+        }
+    };
+
+    std::vector<std::thread> workers;
+    size_t chunk = thread_count ? (c_x_batch.size() + thread_count - 1) / thread_count : 0;
+    for (unsigned t = 1; t < thread_count; t++)
+        workers.emplace_back(evaluate_chunk, std::min(t * chunk, c_x_batch.size()), std::min((t + 1) * chunk, c_x_batch.size()));
+    if (thread_count)
+        evaluate_chunk(0, std::min(chunk, c_x_batch.size()));
+    for (auto &worker : workers)
+        worker.join();
+
+    return d_x_batch;
 }
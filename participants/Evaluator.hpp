@@ -2,18 +2,30 @@
  *  Client
  * */
 #pragma once
-#include <NTL/ZZ_pE.h>
+#include <vector>
+#include "../operations/RingElement.hpp"
+#include "NoisePool.hpp"
 
 
 class Evaluator
 {
 public:
-    NTL::ZZ_pE  a,
+    RingElement a,
                 k,
                 e,
                 c,
                 E,
                 c_x;
-    NTL::ZZ_pE compute_d_x();
-    NTL::ZZ_pE compute_c(NTL::ZZ_pE a);
-};
\ No newline at end of file
+    std::vector<uint8_t> a_seed;    /**< seed a is expanded from, published instead of a */
+    NTTPolynomial   a_ntt,      /**< transform-domain copies of the commitment, built once by commit() */
+                    k_ntt,
+                    c_ntt;
+    RingElement compute_d_x();
+    RingElement evaluate(const RingElement& c_x) const;
+    RingElement evaluate(const RingElement& c_x, NoisePool& noise_pool) const;
+    std::vector<RingElement> compute_d_x_batch(const std::vector<RingElement>& c_x_batch, unsigned thread_count = 0) const;
+    RingElement compute_c(const RingElement& a);
+    void generate_a_seed();
+    void load_a_seed(const uint8_t* seed);
+    void commit();
+};
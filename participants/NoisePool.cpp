@@ -0,0 +1,107 @@
+/**
+ *  Pool of pre-sampled flooding noise E for the evaluator
+ */
+#include "NoisePool.hpp"
+#include "../operations/Crypto.hpp"
+
+
+/**
+ * @brief Overwrites both representations in a way the compiler cannot optimize away.
+ */
+void FloodingNoise::zeroize()
+{
+    coefficients.zeroize();
+    volatile uint64_t *residues = transform.residues.data();
+    for (size_t i = 0; i < transform.residues.size(); i++)
+        residues[i] = 0;
+}
+
+/**
+ * @brief Starts the producer, which fills the pool right away.
+ * @param capacity maximum number of pre-sampled polynomials
+ * @param transform_domain keep E in transform domain instead of as coefficients
+ */
+NoisePool::NoisePool(std::size_t capacity, bool transform_domain)
+    : capacity(capacity), transform_domain(transform_domain), mutex(), not_full(), pool(), producer()
+{
+    producer = std::thread(&NoisePool::produce, this);
+}
+
+/**
+ * @brief Stops the producer and zeroizes the noise that was never handed out.
+ */
+NoisePool::~NoisePool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    not_full.notify_all();
+    producer.join();
+    for (FloodingNoise &noise : pool)
+        noise.zeroize();
+}
+
+/**
+ * @brief Samples E from [-B,B], transformed if the pool keeps the transform.
+ */
+FloodingNoise NoisePool::sample() const
+{
+    FloodingNoise noise;
+    sampleBigUniformPolynomial(B, noise.coefficients);
+    if (transform_domain)
+    {
+        noise.transform = ringTransform(noise.coefficients);
+        noise.coefficients.zeroize();
+    }
+    return noise;
+}
+
+/**
+ * @brief Producer loop, samples outside the lock whenever the pool is below capacity.
+ */
+void NoisePool::produce()
+{
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            not_full.wait(lock, [this] { return stopping || pool.size() < capacity; });
+            if (stopping)
+                return;
+        }
+
+        FloodingNoise noise = sample();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pool.push_back(std::move(noise));
+        }
+        noise.zeroize();                    // RingElement moves are copies, clear the noise left behind
+    }
+}
+
+/**
+ * @brief Hands out one E, which is removed from the pool.
+ */
+FloodingNoise NoisePool::take()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!pool.empty())
+        {
+            FloodingNoise noise = std::move(pool.front());
+            pool.front().zeroize();         // RingElement moves are copies, clear the noise left behind
+            pool.pop_front();
+            not_full.notify_one();
+            return noise;
+        }
+    }
+    return sample();
+}
+
+std::size_t NoisePool::size() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return pool.size();
+}
@@ -0,0 +1,55 @@
+/**
+ *  Pool of pre-sampled flooding noise E for the evaluator
+ */
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include "../operations/RingElement.hpp"
+
+/**
+ * @brief One flooding noise polynomial E from [-B,B], held either as coefficients or in transform domain.
+ */
+struct FloodingNoise
+{
+    RingElement     coefficients;   /**< E, filled if the pool does not keep the transform */
+    NTTPolynomial   transform;      /**< transform of E, filled if the pool keeps the transform */
+
+    void zeroize();
+};
+
+/**
+ * @brief Bounded pool of flooding noise, refilled by a background producer thread.
+ * Every E is handed out once by take() and must be zeroized by the consumer after use; take() samples on the
+ * spot if the producer has fallen behind. With transform_domain the producer also transforms E, so the
+ * evaluator adds it with the pointwise multiply-add of c_x*k (see Evaluator::evaluate).
+ */
+class NoisePool
+{
+public:
+    explicit NoisePool(std::size_t capacity, bool transform_domain = true);
+    ~NoisePool();
+
+    NoisePool(const NoisePool &) = delete;
+    NoisePool &operator=(const NoisePool &) = delete;
+
+    FloodingNoise take();
+    std::size_t size() const;
+    bool transformDomain() const { return transform_domain; }
+
+private:
+    void produce();
+    FloodingNoise sample() const;
+
+    const std::size_t capacity;
+    const bool transform_domain;
+
+    mutable std::mutex mutex;
+    std::condition_variable not_full;
+    std::deque<FloodingNoise> pool;
+    bool stopping = false;
+
+    std::thread producer;
+};
@@ -0,0 +1,159 @@
+/**
+ *  Verification server, a worker pool running the evaluator and KEM halves of PQ-BRAKE verifications
+ */
+#include "VerificationServer.hpp"
+#include "../operations/KEMPool.hpp"
+#include <algorithm>
+#include <exception>
+
+
+/**
+ * @brief Starts the worker pool.
+ * @param server server keys, spk enters the key derivation
+ * @param evaluator committed evaluator, shared read-only by all workers
+ * @param thread_count number of worker threads, 0 uses all hardware threads
+ * @param kem_version liboqs name of the KEM
+ * @param noise_pool optional pool of flooding noise shared by the workers, must outlive the server
+ */
+VerificationServer::VerificationServer(const Server &server, const Evaluator &evaluator, unsigned thread_count,
+                                       const std::string &kem_version, NoisePool *noise_pool)
+    : server(server), evaluator(evaluator), kem_version(kem_version), noise_pool(noise_pool), mutex(), session_ready(), queue(),
+      busy_since(), workers()
+{
+    if (thread_count == 0)
+        thread_count = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned t = 0; t < thread_count; t++)
+        workers.emplace_back(&VerificationServer::work, this);
+}
+
+/**
+ * @brief Finishes the queued sessions and joins the workers.
+ */
+VerificationServer::~VerificationServer()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    session_ready.notify_all();
+    for (auto &worker : workers)
+        worker.join();
+}
+
+/**
+ * @brief Queues a verification session.
+ * @param request values sent by the client
+ * The future receives the response, or the exception a worker ran into.
+ */
+std::future<VerificationResponse> VerificationServer::submit(VerificationRequest request)
+{
+    Session session{std::move(request), std::promise<VerificationResponse>(), std::chrono::steady_clock::now()};
+    std::future<VerificationResponse> response = session.response.get_future();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (in_flight++ == 0)
+            busy_since = session.submitted;
+        queue.push_back(std::move(session));
+    }
+    session_ready.notify_one();
+    return response;
+}
+
+/**
+ * @brief Statistics of the sessions completed so far.
+ * Throughput only counts the time in which the server had work, so idle time before and between bursts
+ * of sessions does not lower it.
+ */
+VerificationStatistics VerificationServer::statistics() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    VerificationStatistics statistics;
+    statistics.completed = completed;
+    statistics.busy_seconds = busy_seconds;
+    if (in_flight > 0)
+        statistics.busy_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - busy_since).count();
+    statistics.throughput = statistics.busy_seconds > 0 ? completed / statistics.busy_seconds : 0;
+    statistics.average_latency_ms = completed ? total_latency_ms / completed : 0;
+    statistics.max_latency_ms = max_latency_ms;
+    return statistics;
+}
+
+unsigned VerificationServer::threadCount() const
+{
+    return (unsigned) workers.size();
+}
+
+/**
+ * @brief Worker loop, takes sessions from the queue until the server stops and the queue is empty.
+ */
+void VerificationServer::work()
+{
+    for (;;)
+    {
+        Session session;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            session_ready.wait(lock, [this] { return stopping || !queue.empty(); });
+            if (queue.empty())
+                return;
+            session = std::move(queue.front());
+            queue.pop_front();
+        }
+
+        try
+        {
+            VerificationResponse response = process(session.request);
+            response.latency_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - session.submitted).count();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                completed++;
+                total_latency_ms += response.latency_ms;
+                max_latency_ms = std::max(max_latency_ms, response.latency_ms);
+                finishSession();
+            }
+            session.response.set_value(std::move(response));
+        } catch (...) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                finishSession();
+            }
+            session.response.set_exception(std::current_exception());
+        }
+    }
+}
+
+/**
+ * @brief Closes the busy period when the last session in flight finishes, the caller holds the mutex.
+ */
+void VerificationServer::finishSession()
+{
+    if (--in_flight == 0)
+        busy_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - busy_since).count();
+}
+
+/**
+ * @brief Server half of one verification: OPRF evaluation, ephemeral key, encapsulation and key derivation.
+ */
+VerificationResponse VerificationServer::process(const VerificationRequest &request) const
+{
+    VerificationResponse response;
+
+    /* EVALUATOR computes d_x = c_x*k + E */
+    response.d_x = noise_pool ? evaluator.evaluate(request.c_x, *noise_pool) : evaluator.evaluate(request.c_x);
+
+    /* SERVER creates its ephemeral key and encapsulates gamma under the enrolled key, with the worker's pooled KEM handles */
+    KEMPool::Lease ephemeral_kem = KEMPool::borrow(kem_version), enrolled_kem = KEMPool::borrow(kem_version);
+    response.server_ephemeral_public_key = ephemeral_kem->generateKeypair();
+    const oqs::bytes &gamma = enrolled_kem->encapsulate(request.enrolled_public_key);
+    response.ciphertext = enrolled_kem->ciphertext();
+
+    /* derived shared secret, KDF is a simple SHA256 hash over the concatenated values */
+    response.shared_secret = SHA256Context::threadLocal().reset()
+                                                         .update(request.enrolled_public_key)
+                                                         .update(request.client_ephemeral_public_key)
+                                                         .update(server.public_key)
+                                                         .update(response.server_ephemeral_public_key)
+                                                         .update(gamma)
+                                                         .finish();
+    return response;
+}
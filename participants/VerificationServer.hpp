@@ -0,0 +1,102 @@
+/**
+ *  Verification server, a worker pool running the evaluator and KEM halves of PQ-BRAKE verifications
+ */
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../oqs_cpp.h"
+#include "../operations/SHA256.hpp"
+#include "Evaluator.hpp"
+#include "Server.hpp"
+
+/**
+ * @brief Values a verifying client sends to the server.
+ */
+struct VerificationRequest
+{
+    RingElement c_x;                            /**< blinded OPRF input */
+    oqs::bytes  enrolled_public_key,            /**< public key stored at enrollment (cpkt) */
+                client_ephemeral_public_key;    /**< cpke */
+};
+
+/**
+ * @brief Server side result of one verification.
+ */
+struct VerificationResponse
+{
+    RingElement     d_x;                            /**< blinded evaluation, sent to the client */
+    oqs::bytes      ciphertext,                     /**< encapsulation of gamma under the enrolled key, sent to the client */
+                    server_ephemeral_public_key;    /**< spke, sent to the client */
+    SHA256Digest    shared_secret{};                /**< SHA256(cpkt || cpke || spk || spke || gamma), kept by the server */
+    double          latency_ms = 0;                 /**< from submission to completion, queueing included */
+};
+
+/**
+ * @brief Throughput and latency of the sessions completed so far.
+ */
+struct VerificationStatistics
+{
+    std::size_t completed = 0;
+    double      busy_seconds = 0,           /**< time with at least one session queued or running, idle time excluded */
+                throughput = 0,             /**< completed sessions per busy second */
+                average_latency_ms = 0,
+                max_latency_ms = 0;
+};
+
+/**
+ * @brief Fixed pool of worker threads serving a queue of verification sessions.
+ * Every session evaluates the OPRF for the client (Evaluator::evaluate), creates the server's ephemeral key,
+ * encapsulates a fresh secret under the enrolled key and derives the shared secret. The evaluator must be
+ * committed and stay unchanged while the server runs, it is only read by the workers. With a noise pool the
+ * workers take the flooding noise from it instead of sampling it per session.
+ */
+class VerificationServer
+{
+public:
+    VerificationServer(const Server &server, const Evaluator &evaluator, unsigned thread_count = 0,
+                       const std::string &kem_version = "Kyber768", NoisePool *noise_pool = nullptr);
+    ~VerificationServer();
+
+    VerificationServer(const VerificationServer &) = delete;
+    VerificationServer &operator=(const VerificationServer &) = delete;
+
+    std::future<VerificationResponse> submit(VerificationRequest request);
+    VerificationStatistics statistics() const;
+    unsigned threadCount() const;
+
+private:
+    struct Session
+    {
+        VerificationRequest request;
+        std::promise<VerificationResponse> response;
+        std::chrono::steady_clock::time_point submitted;
+    };
+
+    void work();
+    void finishSession();
+    VerificationResponse process(const VerificationRequest &request) const;
+
+    const Server &server;
+    const Evaluator &evaluator;
+    const std::string kem_version;
+    NoisePool *const noise_pool;
+
+    mutable std::mutex mutex;
+    std::condition_variable session_ready;
+    std::deque<Session> queue;
+    bool stopping = false;
+
+    std::size_t completed = 0,
+                in_flight = 0;              /**< sessions submitted and not finished yet */
+    double total_latency_ms = 0, max_latency_ms = 0,
+           busy_seconds = 0;                /**< closed busy periods, the open one is added by statistics() */
+    std::chrono::steady_clock::time_point busy_since;
+
+    std::vector<std::thread> workers;
+};
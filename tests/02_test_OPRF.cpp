@@ -10,16 +10,40 @@
 
 #include <NTL/tools.h>
 #include <NTL/RR.h>
+#include <cctype>
+#include <cerrno>
 #include <chrono>
+#include <cstdlib>
 #include "../operations/Crypto.hpp"
 #include "../operations/Helpers.hpp"
+#include "../operations/KEMPool.hpp"
+#include "../operations/Random.hpp"
+#include "../operations/RingElement.hpp"
+#include "../operations/Ternary.hpp"
+#include "../participants/NoisePool.hpp"
+#include "../participants/VerificationServer.hpp"
 #include <fstream>
+#include <thread>
 
 
 using namespace std;
 using namespace NTL;
 
-int main() {
+int main(int argc, char *argv[]) {
+    /* optional argument: seed for deterministic (reproducible) randomness, benchmarking only */
+    if (argc > 1)
+    {
+        char *seed_end = nullptr;
+        errno = 0;
+        unsigned long long seed = strtoull(argv[1], &seed_end, 10);
+        if (argc > 2 || !isdigit((unsigned char) argv[1][0]) || *seed_end != '\0' || errno == ERANGE)
+        {
+            cout << "ERROR!\nUsage hint: 02_test_OPRF [seed], seed is a non-negative integer below 2^64 that makes the randomness deterministic (benchmarking only)." << endl;
+            exit(1);
+        }
+        RandomGenerator::setDeterministicSeed(seed);
+    }
+
     ringSetup();    // creates cyclotomic polynomial, defines modulo (q) and creates ring
     /* initializing protocol participant objects */
     Client client_machine;
@@ -36,8 +60,156 @@ int main() {
     cout << "\nExpected unblinding failure rate: " << computeExpectedErrorRate() * 100
          << " %\n--------------------------------------------------------------------\n";
 
+    /* checks the RNS/NTT ring product against the NTL ZZ_pE product on random and edge inputs */
+    int ring_product_mismatches = 0, ring_product_checks = 0;
+    {
+        ZZ_pX max_x, monomial_x, ternary_a_x, ternary_b_x;
+        for (long i = 0; i < N; i++) {
+            SetCoeff(max_x, i, conv<ZZ_p>(q - 1));
+            SetCoeff(ternary_a_x, i, conv<ZZ_p>(RandomBnd(3) - 1));
+            SetCoeff(ternary_b_x, i, conv<ZZ_p>(RandomBnd(3) - 1));
+        }
+        SetCoeff(monomial_x, N - 1);    // x^(N-1) * x^(N-1) wraps around to -x^(N-2)
+
+        ZZ_pE zero, max = conv<ZZ_pE>(max_x), monomial = conv<ZZ_pE>(monomial_x),
+              ternary_a = conv<ZZ_pE>(ternary_a_x), ternary_b = conv<ZZ_pE>(ternary_b_x),
+              random_a = random_ZZ_pE(), random_b = random_ZZ_pE();
+
+        vector<pair<ZZ_pE, ZZ_pE>> ring_product_cases = {
+                {zero, zero}, {zero, random_a}, {max, max}, {max, random_a}, {monomial, monomial},
+                {ternary_a, ternary_b}, {ternary_a, max}, {ternary_a, random_a}, {random_a, random_b}};
+        for (int i = 0; i < 8; i++)
+            ring_product_cases.emplace_back(random_ZZ_pE(), random_ZZ_pE());
+
+        for (const auto &ring_product_case : ring_product_cases) {
+            RingElement product = ringMultiply(RingElement::fromZZ_pE(ring_product_case.first),
+                                               RingElement::fromZZ_pE(ring_product_case.second));
+            if (product.toZZ_pE() != ring_product_case.first * ring_product_case.second)
+                ring_product_mismatches++;
+            ring_product_checks++;
+        }
+    }
+    cout << "Ring product (RNS/NTT) mismatches against NTL: " << ring_product_mismatches
+         << " (out of " << ring_product_checks << ")"
+         << "\n--------------------------------------------------------------------\n";
+    if (ring_product_mismatches != 0)
+        return 1;
+
+    /* checks the multi-buffer hash-to-ring against the legacy per-coefficient path existing enrollments used */
+    int hash_to_ring_mismatches = 0, hash_to_ring_checks = 0;
+    for (long degree : {0L, 6L, 16L, 100L, 1000L}) {
+        for (long bound : {2L, 1L << 18}) {
+            ZZX secret_polynomial;
+            for (long i = 0; i < degree; i++)
+                SetCoeff(secret_polynomial, i, RandomBnd(bound));
+            SetCoeff(secret_polynomial, degree, 1 + RandomBnd(bound - 1));
+
+            vector<string> hashed_coefficients = hashCoefficients(secret_polynomial);
+            vector<ZZ> a_x_coeff(N + 1);
+            for (long i = 0; i <= N; i++)
+                a_x_coeff[i] = hashDigestToIntegerModQ(hashed_coefficients[i]);
+            RingElement legacy_a_x = spawnRingPolynomial(a_x_coeff.data()), multi_buffer_a_x;
+            hashCoefficientsToRing(secret_polynomial, multi_buffer_a_x);
+
+            for (long i = 0; i < N; i++) {
+                if (legacy_a_x.coefficient(i) != multi_buffer_a_x.coefficient(i)) {
+                    hash_to_ring_mismatches++;
+                    break;
+                }
+            }
+            hash_to_ring_checks++;
+        }
+    }
+    cout << "Hash-to-ring (multi-buffer SHA256) mismatches against the legacy a_x: " << hash_to_ring_mismatches
+         << " (out of " << hash_to_ring_checks << ")"
+         << "\n--------------------------------------------------------------------\n";
+    if (hash_to_ring_mismatches != 0)
+        return 1;
+
+    /* checks the packed rounding kernels against the exact centered lift, ceil(centered(u)*p/q - 1/2),
+     * on the rounding thresholds and their neighbours (cycled through every lane position) and on random values
+     */
+    long rounding_mismatches = 0, rounding_checks = 0;
+    {
+        const uint128_t q_word = ringModulus().q;
+        vector<uint128_t> edge_values = {0, 1, q_word - 2, q_word - 1};
+        for (uint128_t threshold : {q_word / 4, q_word / 2, (3 * q_word) / 4})
+            for (uint128_t value : {threshold - 1, threshold, threshold + 1})
+                edge_values.push_back(value);
+
+        RingElement edge_polynomial, random_polynomial;
+        for (long i = 0; i < N; i++) {
+            edge_polynomial.setCoefficient(i, edge_values[i % edge_values.size()]);
+            random_polynomial.setCoefficient(i, ZZToWord128(RandomBnd(q)));
+        }
+
+        vector<RoundingKernel> rounding_kernels = {RoundingKernel::Scalar};
+        if (N % 64 == 0 && __builtin_cpu_supports("avx2"))
+            rounding_kernels.push_back(RoundingKernel::AVX2);
+
+        for (const RingElement *polynomial : {&edge_polynomial, &random_polynomial}) {
+            vector<long> reference(N);
+            for (long i = 0; i < N; i++) {
+                ZZ u = word128ToZZ(polynomial->coefficient(i)), centered = u > q / 2 ? u - q : u;
+                reference[i] = -conv<long>((q - 2 * p * centered) / (2 * q));    // ZZ division rounds down
+            }
+            for (RoundingKernel kernel : rounding_kernels) {
+                RoundedPolynomial rounded;
+                roundingPacked(*polynomial, rounded, kernel);
+                for (long i = 0; i < N; i++) {
+                    if (rounded.coefficient(i) != reference[i])
+                        rounding_mismatches++;
+                    rounding_checks++;
+                }
+            }
+        }
+    }
+    cout << "Rounding (packed kernels) mismatches against the exact reference: " << rounding_mismatches
+         << " (out of " << rounding_checks << " coefficients)"
+         << "\n--------------------------------------------------------------------\n";
+    if (rounding_mismatches != 0)
+        return 1;
+
+    /* checks the streamed legacy KEM seed against the first 32 characters of hashSHA256(printZZXconcatenated(...)),
+     * which existing enrollments were derived from; covers the zero output, single coefficients around word
+     * boundaries and random outputs of varying degree
+     */
+    int kem_seed_mismatches = 0, kem_seed_checks = 0;
+    {
+        vector<RoundedPolynomial> kem_seed_cases(1);     // zero output
+        for (auto [index, value] : {pair<long, int>{0, 1}, {0, -1}, {63, 1}, {64, -1}, {N - 1, -1}}) {
+            RoundedPolynomial single;
+            single.parity[index / 64] |= 1ULL << (index % 64);
+            if (value < 0)
+                single.sign[index / 64] |= 1ULL << (index % 64);
+            kem_seed_cases.push_back(single);
+        }
+        for (long words : {RoundedPolynomial::WORDS, RoundedPolynomial::WORDS, RoundedPolynomial::WORDS / 2, 1L, 2L}) {
+            RoundedPolynomial random_output;
+            for (long w = 0; w < words; w++) {
+                random_output.parity[w] = RandomGenerator::threadLocal().next64();
+                random_output.sign[w] = random_output.parity[w] & RandomGenerator::threadLocal().next64();
+            }
+            kem_seed_cases.push_back(random_output);
+        }
+
+        for (const RoundedPolynomial &output : kem_seed_cases) {
+            uint8_t kem_seed[KEM_SEED_SIZE];
+            hashRoundedPolynomial(output, kem_seed, KEMSeedMode::Legacy);
+            string legacy_seed = hashSHA256(printZZXconcatenated(output.toZZX())).substr(0, KEM_SEED_SIZE);
+            if (string(kem_seed, kem_seed + KEM_SEED_SIZE) != legacy_seed)
+                kem_seed_mismatches++;
+            kem_seed_checks++;
+        }
+    }
+    cout << "Legacy KEM seed (streamed) mismatches against hashSHA256(printZZXconcatenated(...)): " << kem_seed_mismatches
+         << " (out of " << kem_seed_checks << ")"
+         << "\n--------------------------------------------------------------------\n";
+    if (kem_seed_mismatches != 0)
+        return 1;
+
     /* setting up helper variables for testing */
-    int OPRF_fail_counter = 0, iter = 1, iterations;
+    int OPRF_fail_counter = 0, ternary_mismatch_counter = 0, iter = 1, iterations;
     vector<double>  timings,
                     sampling_big_a,
                     sampling_small_k,
@@ -50,7 +222,9 @@ int main() {
                     sampling_big_E,
                     compute_d_x,
                     compute_y,
-                    rounding_y;
+                    rounding_y,
+                    product_generic,
+                    product_ternary;
 
     /* testing parameter input */
     cout << "Choose number of test iterations (1 - 10 000) [warning: long runtime - about 30ms expected per iteration]: ";
@@ -89,6 +263,18 @@ int main() {
             OPRFCheckLogging(&client_machine, &evaluator_machine, log_failed_OPRF_iterations, iter);
 
             timings.push_back(std::chrono::duration<double, std::milli>(OPRF_timer_end - OPRF_timer_start).count());
+
+            /* compares the generic NTT product with the ternary kernel on the evaluator's c_x * k */
+            TernaryPolynomial k_ternary = TernaryPolynomial::fromRingElement(evaluator_machine.k);
+            auto generic_start = chrono::steady_clock::now();
+            RingElement generic_result = ringMultiply(evaluator_machine.c_x, evaluator_machine.k);
+            auto generic_end = chrono::steady_clock::now();
+            RingElement ternary_result = ternaryMultiply(evaluator_machine.c_x, k_ternary);
+            auto ternary_end = chrono::steady_clock::now();
+            if (generic_result != ternary_result)
+                ternary_mismatch_counter++;
+            product_generic.push_back(chrono::duration<double, milli>(generic_end - generic_start).count());
+            product_ternary.push_back(chrono::duration<double, milli>(ternary_end - generic_end).count());
         } catch (int exc) {
             /* notes a failed OPRF unblinding */
             OPRF_fail_counter++;
@@ -114,9 +300,129 @@ int main() {
     cout << "Average compute_y OPRF runtime (ms): " << computeAverage(compute_y) << "\n";
     cout << "Average rounding_y OPRF runtime (ms): " << computeAverage(rounding_y) << "\n";
     cout << "Average (successful) OPRF runtime (ms): " << computeAverage(timings) << "\n";
+    cout << "Average generic (NTT) c_x * k runtime (ms): " << computeAverage(product_generic) << "\n";
+    cout << "Average ternary kernel c_x * k runtime (ms): " << computeAverage(product_ternary) << "\n";
+    cout << "Ternary kernel mismatches: " << ternary_mismatch_counter << "\n";
+    cout << "--------------------------------------------------------------------" << "\n";
+
+    /* evaluator throughput, one request at a time and batched over all hardware threads */
+    const size_t batch_size = 256;
+    const unsigned cores = max(1u, thread::hardware_concurrency());
+    vector<RingElement> c_x_batch(batch_size, evaluator_machine.c_x);
+
+    auto single_start = chrono::steady_clock::now();
+    for (size_t i = 0; i < batch_size; i++)
+    {
+        evaluator_machine.E = sampleBigUniformPolynomial(B);
+        client_machine.d_x = evaluator_machine.compute_d_x();
+    }
+    auto single_end = chrono::steady_clock::now();
+    vector<RingElement> d_x_batch = evaluator_machine.compute_d_x_batch(c_x_batch);
+    auto batch_end = chrono::steady_clock::now();
+
+    /* request time with the flooding noise pre-sampled in transform domain, the pool is filled beforehand */
+    double pooled_seconds;
+    {
+        NoisePool noise_pool(batch_size);
+        while (noise_pool.size() < batch_size)
+            this_thread::sleep_for(chrono::milliseconds(10));
+        auto pooled_start = chrono::steady_clock::now();
+        for (size_t i = 0; i < batch_size; i++)
+            client_machine.d_x = evaluator_machine.evaluate(evaluator_machine.c_x, noise_pool);
+        pooled_seconds = chrono::duration<double>(chrono::steady_clock::now() - pooled_start).count();
+    }
+
+    double single_seconds = chrono::duration<double>(single_end - single_start).count(),
+           batch_seconds = chrono::duration<double>(batch_end - single_end).count();
+    cout << "------------------------ EVALUATOR THROUGHPUT ----------------------" << "\n";
+    cout << "Batch size: " << batch_size << ", threads: " << cores << "\n";
+    cout << "Single compute_d_x (requests/s/core): " << batch_size / single_seconds << "\n";
+    cout << "Single evaluate with noise pool (requests/s/core): " << batch_size / pooled_seconds << "\n";
+    cout << "Batched compute_d_x_batch (requests/s): " << batch_size / batch_seconds << "\n";
+    cout << "Batched compute_d_x_batch (requests/s/core): " << batch_size / batch_seconds / cores << "\n";
+    cout << "--------------------------------------------------------------------" << "\n";
+
+    /* concurrent OPRF sessions, distinct clients sharing the committed evaluator, each thread installs the
+     * NTL ring context with a guard and round-trips its a_x through ZZ_pE
+     */
+    const unsigned concurrent_threads = max(2u, cores), sessions_per_thread = 8;
+    vector<unsigned> concurrent_failures(concurrent_threads, 0), context_mismatches(concurrent_threads, 0);
+    {
+        vector<thread> sessions;
+        for (unsigned t = 0; t < concurrent_threads; t++)
+            sessions.emplace_back([&, t] {
+                RingContextGuard guard;
+                Client client;
+                for (unsigned i = 0; i < sessions_per_thread; i++) {
+                    OPRF(&client, &evaluator_machine, true);
+                    try {
+                        OPRFCheck(&client, &evaluator_machine);
+                    } catch (int exc) {
+                        concurrent_failures[t]++;
+                    }
+                    if (RingElement::fromZZ_pE(client.a_x.toZZ_pE()) != client.a_x)
+                        context_mismatches[t]++;
+                }
+            });
+        for (auto &session : sessions)
+            session.join();
+    }
+    unsigned concurrent_failed = 0, concurrent_context_mismatches = 0;
+    for (unsigned t = 0; t < concurrent_threads; t++) {
+        concurrent_failed += concurrent_failures[t];
+        concurrent_context_mismatches += context_mismatches[t];
+    }
+    const unsigned concurrent_sessions = concurrent_threads * sessions_per_thread;
+    /* a few unblinding failures are expected, a session sharing state with another thread fails (nearly) always */
+    const bool concurrent_sessions_ok = concurrent_context_mismatches == 0 &&
+                                        concurrent_failed <= 1 + 10 * conv<double>(computeExpectedErrorRate()) * concurrent_sessions;
+    cout << "------------------------ CONCURRENT OPRF ---------------------------" << "\n";
+    cout << "Sessions: " << concurrent_sessions << ", threads: " << concurrent_threads << "\n";
+    cout << "Failed OPRFCheck: " << concurrent_failed << " (out of " << concurrent_sessions << ")\n";
+    cout << "Ring context round-trip mismatches: " << concurrent_context_mismatches << " (out of " << concurrent_sessions << ")\n";
+    cout << "--------------------------------------------------------------------" << "\n";
+
+    /* verification server, evaluator and KEM halves of batch_size sessions on a worker pool */
+    KEMPool::Lease server_kem = KEMPool::borrow("Kyber768"), enrolled_kem = KEMPool::borrow("Kyber768"),
+                   ephemeral_kem = KEMPool::borrow("Kyber768");
+    server_machine.public_key = server_kem->generateKeypair();
+    VerificationRequest request{evaluator_machine.c_x, enrolled_kem->generateKeypair(), ephemeral_kem->generateKeypair()};
+    VerificationStatistics pool_statistics;
+    unsigned pool_threads;
+    int session_key_mismatches = 0;
+    {
+        VerificationServer verification_server(server_machine, evaluator_machine, cores);
+        pool_threads = verification_server.threadCount();
+        vector<future<VerificationResponse>> responses;
+        for (size_t i = 0; i < batch_size; i++)
+            responses.push_back(verification_server.submit(request));
+        for (auto &response_future : responses) {
+            /* the client decapsulates gamma with the enrolled secret key and must derive the server's shared secret */
+            VerificationResponse response = response_future.get();
+            const oqs::bytes &gamma = enrolled_kem->decapsulate(response.ciphertext);
+            SHA256Digest client_shared_secret = SHA256Context::threadLocal().reset()
+                                                                            .update(request.enrolled_public_key)
+                                                                            .update(request.client_ephemeral_public_key)
+                                                                            .update(server_machine.public_key)
+                                                                            .update(response.server_ephemeral_public_key)
+                                                                            .update(gamma)
+                                                                            .finish();
+            if (client_shared_secret != response.shared_secret)
+                session_key_mismatches++;
+        }
+        pool_statistics = verification_server.statistics();
+    }
+    cout << "------------------------ VERIFICATION SERVER -----------------------" << "\n";
+    cout << "Sessions: " << pool_statistics.completed << ", worker threads: " << pool_threads << "\n";
+    cout << "Shared secret mismatches (client decapsulation): " << session_key_mismatches << "\n";
+    cout << "Throughput (sessions per busy second): " << pool_statistics.throughput << "\n";
+    cout << "Average latency, queueing included (ms): " << pool_statistics.average_latency_ms << "\n";
+    cout << "Maximum latency (ms): " << pool_statistics.max_latency_ms << "\n";
     cout << "--------------------------------------------------------------------" << "\n";
 
     log_failed_OPRF_iterations.close();
 
+    if (!concurrent_sessions_ok || session_key_mismatches != 0)
+        return 1;
     return 0;
 }
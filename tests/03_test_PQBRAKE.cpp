@@ -5,10 +5,12 @@
  * Simulates the enrollment of a reference fingerprint and an attempt to verify a user with a query fingerprint.
  * It is possible to change the parameters for the OPRF mechanism by editing the
  * parameters.hpp file (instructions inside) and recompiling.
- * However, the CRYSTALS-Kyber KEM parameters are fixed as Kyber768 is used.
+ * The KEM is chosen at runtime by its liboqs name and defaults to Kyber768. The seeded key generation requires
+ * a KEM supported by the modified liboqs (CRYSTALS-Kyber).
  * The results are output into a .csv file.
  * @param reference_fingerprint grayscale .pgm image of a fingerprint that is "enrolled" into the fuzzy vault
  * @param query_fingerprint grayscale .pgm image of a fingerprint that queries the fuzzy vault
+ * @param kem_algorithm optional liboqs name of the KEM, must be enabled in liboqs
  * @author Matej Poljuha
  */
 
@@ -16,7 +18,10 @@
 #include <openssl/ec.h>
 #include "../fuzzyVault/Thimble.hpp"
 #include "../operations/Crypto.hpp"
+#include "../operations/EphemeralKeyPool.hpp"
 #include "../operations/Helpers.hpp"
+#include "../operations/KEMPool.hpp"
+#include "../operations/SHA256.hpp"
 
 
 using namespace std;
@@ -37,10 +42,20 @@ int main(int argc, char **argv)
     /* ring setup for OPRF process */
     ringSetup();
 
-    /* check if exactly two arguments are provided */
-    if (argc != 3)
+    /* check if two or three arguments are provided */
+    if (argc != 3 && argc != 4)
     {
-        cout << "ERROR!\nUsage hint: 03_test_PQBRAKE <path to reference image> <path to query image> NOTE: images must be in .pgm format." << endl;
+        cout << "ERROR!\nUsage hint: 03_test_PQBRAKE <path to reference image> <path to query image> [Kyber512|Kyber768|Kyber1024] NOTE: images must be in .pgm format." << endl;
+        exit(1);
+    }
+
+    /* KEM of the protocol, it must be enabled in liboqs and derive its keypair from the OPRF output (Kyber only) */
+    string kem_algorithm = argc == 4 ? argv[3] : "Kyber768";
+    try
+    {
+        requireSeededKEM(kem_algorithm);
+    } catch (const invalid_argument &exc) {
+        cout << "ERROR!\n" << exc.what() << endl;
         exit(1);
     }
 
@@ -54,11 +69,15 @@ int main(int argc, char **argv)
     string query_fingerprint_filename = query_fingerprint_path.substr(query_fingerprint_path.find_last_of('/')+1, query_fingerprint_path.find_last_of('.')-query_fingerprint_path.find_last_of('/')-1);;
     cout << setw(23) << "Reference fingerprint: " << reference_fingerprint_filename << "\n";
     cout << setw(23) << "Query fingerprint: " << query_fingerprint_filename << "\n";
+    cout << setw(23) << "KEM: " << kem_algorithm << "\n";
     OutputFile.open("PQBRAKE_results.csv", fstream::app);
 
     /* hardcoded values for varying the size of the secret polynomial k */
     int polynomial_sizes[] = {6,6,8,10,12,14,16};
 
+    /* ephemeral keypairs do not depend on the session, both sides pre-generate them in the background */
+    EphemeralKeyPool client_ephemeral_keys(1, kem_algorithm), server_ephemeral_keys(1, kem_algorithm);
+
     /* main test loop */
     int iter = 0;
     bool warmup_run = true; // needed because of memory alloc./caching impacting benchmark
@@ -72,9 +91,11 @@ int main(int argc, char **argv)
         Evaluator evaluator_machine;
 
         /* generates a random keypair for the server */
-        oqs::KeyEncapsulation preliminary_server_key_generator{"Kyber768"};
-        server_machine.public_key = preliminary_server_key_generator.generate_keypair();
-        server_machine.secret_key = preliminary_server_key_generator.export_secret_key();
+        {
+            KEMPool::Lease preliminary_server_key_generator = KEMPool::borrow(kem_algorithm);
+            server_machine.public_key = preliminary_server_key_generator->generateKeypair();
+            server_machine.secret_key = preliminary_server_key_generator->secretKey();
+        }
 
         //---------------------------------------------------------------
         //                         ENROLLMENT
@@ -128,27 +149,19 @@ int main(int argc, char **argv)
 
         try
         {
-            ZZX OPRF_client_enrollment_output = OPRF(&enrolled_client_machine, &evaluator_machine, false);
+            /* the OPRF output is hashed into the KEM key generation seed by the client's finalization */
+            uint8_t bytes_hash[KEM_SEED_SIZE];
+            OPRF(&enrolled_client_machine, &evaluator_machine, false, bytes_hash);
 
             OPRFCheck(&enrolled_client_machine, &evaluator_machine);   // checks if OPRF result is correct
 
-            /* hashes the y_x output value of the OPRF procedure and converts it into a format suitable for
-             * use as key input
-             */
-            string key_input = hashSHA256(printZZXconcatenated(OPRF_client_enrollment_output));
-            uint8_t bytes_hash[32];
-            for(int j=0; j<32; j++)
-            {
-                bytes_hash[j] = unsigned(key_input[j]);
-            }
-
-            oqs::KeyEncapsulation enrollment_KEM_client{"Kyber768"};
+            KEMPool::Lease enrollment_KEM_client = KEMPool::borrow(kem_algorithm);
             auto enrollment_key_generation_start = chrono::steady_clock::now();
-            enrolled_client_machine.public_key = enrollment_KEM_client.generate_keypair_based_on_input(bytes_hash);
+            enrolled_client_machine.public_key = enrollment_KEM_client->generateKeypair(bytes_hash);
             auto enrollment_key_generation_end = chrono::steady_clock::now();
-            enrolled_client_machine.secret_key = enrollment_KEM_client.export_secret_key();
+            enrolled_client_machine.secret_key = enrollment_KEM_client->secretKey();
         } catch (int exc) {
-            cout << "OPRF failure" << endl;
+            cout << "OPRF failure, mismatching coefficients: " << exc << endl;
             printPQBRAKEresultToFile(OutputFile, reference_fingerprint_filename, query_fingerprint_filename, "OPRF_unblinding_failure", empty_timings, empty_timings, empty_timings, empty_timings, empty_timings, empty_timings, empty_timings);
             OutputFile.close();
             exit(1);
@@ -158,6 +171,14 @@ int main(int argc, char **argv)
         //                         VERIFICATION
         //---------------------------------------------------------------
 
+                //-------------------------------
+                //   Offline blinding material
+                //-------------------------------
+
+        /* CLIENT precomputes s, e' and a*s + e' before the fingerprint arrives, off the OPRF critical path */
+        BlindingQueue blinding_queue(evaluator_machine.a_ntt, 1);
+        blinding_queue.fill();
+
                 //-------------------------------
                 //       Fuzzy vault query
                 //-------------------------------
@@ -190,52 +211,43 @@ int main(int argc, char **argv)
                 //-------------------------------
 
         auto keygen_1_start = chrono::steady_clock::now();
-        oqs::KeyEncapsulation ephemeral_keypair_client{"Kyber768"};
-        verifying_client_machine.ephemeral_public_key = ephemeral_keypair_client.generate_keypair();
+        EphemeralKeypair ephemeral_keypair_client = client_ephemeral_keys.take();
+        verifying_client_machine.ephemeral_public_key = std::move(ephemeral_keypair_client.public_key);
+        verifying_client_machine.ephemeral_secret_key = std::move(ephemeral_keypair_client.secret_key);
         auto keygen_1_end = chrono::steady_clock::now();
         keygen_timings[iter] = std::chrono::duration<float, std::milli>(keygen_1_end - keygen_1_start).count();
-        verifying_client_machine.ephemeral_secret_key = ephemeral_keypair_client.export_secret_key();
 
         auto keygen_2_start = chrono::steady_clock::now();
-        oqs::KeyEncapsulation ephemeral_keypair_server{"Kyber768"};
-        server_machine.ephemeral_public_key = ephemeral_keypair_server.generate_keypair();
+        EphemeralKeypair ephemeral_keypair_server = server_ephemeral_keys.take();
+        server_machine.ephemeral_public_key = std::move(ephemeral_keypair_server.public_key);
+        server_machine.ephemeral_secret_key = std::move(ephemeral_keypair_server.secret_key);
         auto keygen_2_end = chrono::steady_clock::now();
         keygen_timings[iter] = keygen_timings[iter] + std::chrono::duration<float, std::milli>(keygen_2_end - keygen_2_start).count();
-        server_machine.ephemeral_secret_key = ephemeral_keypair_server.export_secret_key();
 
                 //-------------------------------
                 //             OPRF
                 //-------------------------------
 
-        oqs::KeyEncapsulation verification_KEM_client{"Kyber768"};   // initializes Client KEM object
+        KEMPool::Lease verification_KEM_client = KEMPool::borrow(kem_algorithm);   // borrows a Client KEM handle
 
         try
         {
             auto OPRF_timer_start = chrono::steady_clock::now();
-            ZZX OPRF_client_verification_output = OPRF(&verifying_client_machine, &evaluator_machine, true);    // OPRF execution
+            uint8_t bytes_hash[KEM_SEED_SIZE];
+            OPRF(&verifying_client_machine, &evaluator_machine, true, bytes_hash, &blinding_queue);    // OPRF execution
             auto OPRF_timer_end = chrono::steady_clock::now();
 
             OPRF_timings[iter] = std::chrono::duration<float, std::milli>(OPRF_timer_end - OPRF_timer_start).count();
 
             OPRFCheck(&verifying_client_machine, &evaluator_machine);   // checks if OPRF result is correct
 
-            /* hashes the y_x output value of the OPRF procedure and converts it into a format suitable for
-             * use as key input
-             */
-            string key_input = hashSHA256(printZZXconcatenated(OPRF_client_verification_output));
-            uint8_t bytes_hash[32];
-            for(int l=0; l<32; l++)
-            {
-                bytes_hash[l] = unsigned(key_input[l]);
-            }
-
             auto keygen_3_start = chrono::steady_clock::now();
-            verifying_client_machine.public_key = verification_KEM_client.generate_keypair_based_on_input(bytes_hash); // generates keypair
+            verifying_client_machine.public_key = verification_KEM_client->generateKeypair(bytes_hash); // generates keypair
             auto keygen_3_end = chrono::steady_clock::now();
             keygen_timings[iter] = keygen_timings[iter] + std::chrono::duration<float, std::milli>(keygen_3_end - keygen_3_start).count();
-            verifying_client_machine.secret_key = verification_KEM_client.export_secret_key();
+            /* the re-derived secret key is not copied out, it stays in the KEM handle for decapsulation */
         } catch (int exc) {
-            cout << "OPRF: failed" << endl;
+            cout << "OPRF: failed, mismatching coefficients: " << exc << endl;
             printPQBRAKEresultToFile(OutputFile, reference_fingerprint_filename, query_fingerprint_filename, "OPRF_unblinding_failure", empty_timings, empty_timings, empty_timings, empty_timings, empty_timings, empty_timings, empty_timings);
             OutputFile.close();
             exit(1);
@@ -245,15 +257,15 @@ int main(int argc, char **argv)
                 //             KEM
                 //-------------------------------
 
-        oqs::KeyEncapsulation KEM_server{"Kyber768"};
+        KEMPool::Lease KEM_server = KEMPool::borrow(kem_algorithm);
         auto encap_start = chrono::steady_clock::now();
-        std::tie(server_machine.ciphertext, server_machine.shared_secret) =
-                KEM_server.encap_secret(enrolled_client_machine.public_key);     // encapsulation
+        server_machine.shared_secret = KEM_server->encapsulate(enrolled_client_machine.public_key);     // encapsulation
+        server_machine.ciphertext = KEM_server->ciphertext();
         auto encap_end = chrono::steady_clock::now();
         encap_timings[iter] = std::chrono::duration<float, std::milli>(encap_end - encap_start).count();
 
         auto decap_start = chrono::steady_clock::now();
-        verifying_client_machine.shared_secret = verification_KEM_client.decap_secret(server_machine.ciphertext);   // decapsulation
+        verifying_client_machine.shared_secret = verification_KEM_client->decapsulate(server_machine.ciphertext);   // decapsulation
         auto decap_end = chrono::steady_clock::now();
         decap_timings[iter] = std::chrono::duration<float, std::milli>(decap_end - decap_start).count();
 
@@ -261,24 +273,24 @@ int main(int argc, char **argv)
                 //        Shared secret
                 //-------------------------------
 
-        string shared_secret_serverside;
-        string shared_secret_clientside;
-
-        string  cpkt(enrolled_client_machine.public_key.begin(), enrolled_client_machine.public_key.end()),
-                cpke(verifying_client_machine.ephemeral_public_key.begin(), verifying_client_machine.ephemeral_public_key.end()),
-                spk(server_machine.public_key.begin(), server_machine.public_key.end()),
-                spke(server_machine.ephemeral_public_key.begin(), server_machine.ephemeral_public_key.end()),
-                gamma(server_machine.shared_secret.begin(), server_machine.shared_secret.end()),
-                cpkt_prime(verifying_client_machine.public_key.begin(), verifying_client_machine.public_key.end()),
-                gamma_prime(verifying_client_machine.shared_secret.begin(), verifying_client_machine.shared_secret.end());
-
-        /* derived shared secrets, KDF is a simple SHA256 hash for this example */
-        shared_secret_serverside = hashSHA256(cpkt + cpke + spk + spke + gamma);
-        shared_secret_clientside = hashSHA256(cpkt_prime + cpke + spk + spke + gamma_prime);
-
-        /* compares hashes of shared secrets */
-        if (hashSHA256(shared_secret_serverside) == hashSHA256(shared_secret_clientside))
-            cout << "RESULT: Verification successful, established shared secret: " << hashSHA256(shared_secret_clientside) << endl;
+        /* derived shared secrets, KDF is a simple SHA256 hash over the concatenated values for this example */
+        SHA256Context &kdf = SHA256Context::threadLocal().reset();
+        SHA256Digest shared_secret_serverside = kdf.update(enrolled_client_machine.public_key)
+                                                   .update(verifying_client_machine.ephemeral_public_key)
+                                                   .update(server_machine.public_key)
+                                                   .update(server_machine.ephemeral_public_key)
+                                                   .update(server_machine.shared_secret)
+                                                   .finish();
+        SHA256Digest shared_secret_clientside = kdf.update(verifying_client_machine.public_key)
+                                                   .update(verifying_client_machine.ephemeral_public_key)
+                                                   .update(server_machine.public_key)
+                                                   .update(server_machine.ephemeral_public_key)
+                                                   .update(verifying_client_machine.shared_secret)
+                                                   .finish();
+
+        /* compares the shared secrets, only a hash of the secret is displayed */
+        if (shared_secret_serverside == shared_secret_clientside)
+            cout << "RESULT: Verification successful, established shared secret: " << toHex(kdf.update(shared_secret_clientside).finish()) << endl;
         else
         {
             cout << "RESULT: Verification failed, shared secrets do not match." << endl;
@@ -338,6 +350,8 @@ int main(int argc, char **argv)
             round(computeAverageFloat(decap_timings)*100)/100
         << "  ";
     cout << "\n";
+    cout << "Ephemeral keypairs pre-generated (hits/misses): client " << client_ephemeral_keys.hits() << "/" << client_ephemeral_keys.misses()
+         << ", server " << server_ephemeral_keys.hits() << "/" << server_ephemeral_keys.misses() << "\n";
 
     return 0;
 }
\ No newline at end of file